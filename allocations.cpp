@@ -0,0 +1,142 @@
+#include <cstdlib>
+#include <new>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "stats.hpp"
+
+// Built into the command line tool with MIPS_ALLOCATION_STATS: the operators
+// new and delete are replaced to count heap allocations and the heap in use
+// for --stats. Every form is replaced (arrays, nothrow, aligned), the library
+// itself doesn't replace anything.
+
+namespace {
+
+// bytes the heap handed out for memory, it can't be told without glibc
+size_t heapSize(void *memory) {
+#ifdef __GLIBC__
+    return malloc_usable_size(memory);
+#else
+    (void) memory;
+    return 0;
+#endif
+}
+
+void *allocate(std::size_t size, std::size_t alignment) {
+    if (size == 0) size = 1;
+    while (true) {
+        // aligned_alloc wants a multiple of the alignment
+        void *memory = alignment <= alignof(std::max_align_t)
+            ? std::malloc(size)
+            : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+        if (memory != nullptr) {
+            countAllocation(size, heapSize(memory));
+            return memory;
+        }
+        const std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void *allocateNothrow(std::size_t size, std::size_t alignment) noexcept {
+    try {
+        return allocate(size, alignment);
+    } catch (const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+
+void deallocate(void *memory) noexcept {
+    if (memory == nullptr) return;
+    countDeallocation(heapSize(memory));
+    std::free(memory);
+}
+
+}  // namespace
+
+// --------------------------------------------------------
+
+void *operator new(std::size_t size) {
+    return allocate(size, 0);
+}
+
+void *operator new[](std::size_t size) {
+    return allocate(size, 0);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return allocateNothrow(size, 0);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return allocateNothrow(size, 0);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return allocateNothrow(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return allocateNothrow(size, static_cast<std::size_t>(alignment));
+}
+
+// --------------------------------------------------------
+
+void operator delete(void *memory) noexcept {
+    deallocate(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+    deallocate(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+    deallocate(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept {
+    deallocate(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept {
+    deallocate(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept {
+    deallocate(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept {
+    deallocate(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept {
+    deallocate(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept {
+    deallocate(memory);
+}
+
+void operator delete[](void *memory, std::size_t, std::align_val_t) noexcept {
+    deallocate(memory);
+}
+
+void operator delete(void *memory, std::align_val_t, const std::nothrow_t &) noexcept {
+    deallocate(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t, const std::nothrow_t &) noexcept {
+    deallocate(memory);
+}
@@ -0,0 +1,31 @@
+#include "arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+void Arena::reset() {
+    if (blocks_.size() > 1) blocks_.erase(blocks_.begin() + 1, blocks_.end());
+    next_ = blocks_.empty() ? nullptr : blocks_.front().get();
+    left_ = blocks_.empty() ? 0 : first_block_size_;
+    bytes_ = 0;
+}
+
+// --------------------------------------------------------
+
+void *Arena::allocateBytes(size_t size, size_t alignment) {
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(next_) % alignment) % alignment;
+    if (next_ == nullptr || padding + size > left_) {
+        // large requests get a block of their own
+        const size_t block_size = std::max(BLOCK_SIZE, size + alignment);
+        blocks_.emplace_back(new char[block_size]);  // not zeroed
+        if (blocks_.size() == 1) first_block_size_ = block_size;
+        next_ = blocks_.back().get();
+        left_ = block_size;
+        padding = (alignment - reinterpret_cast<uintptr_t>(next_) % alignment) % alignment;
+    }
+    char *memory = next_ + padding;
+    next_ += padding + size;
+    left_ -= padding + size;
+    bytes_ += size;
+    return memory;
+}
@@ -0,0 +1,48 @@
+#ifndef MIPS_ARENA_H
+#define MIPS_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Bump allocator. Memory is handed out from large blocks and only
+ * released all at once, when the arena is destroyed or reset. Meant for
+ * arrays of trivial types that live as long as the assembly of a program.
+ */
+class Arena {
+public:
+    static constexpr size_t BLOCK_SIZE = 1 << 20;
+
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /**
+     * @brief Returns uninitialized memory for count objects of type T.
+     */
+    template <typename T>
+    T *allocate(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "the arena never runs destructors");
+        return static_cast<T *>(allocateBytes(count * sizeof(T), alignof(T)));
+    }
+
+    /**
+     * @brief Releases all memory but the first block, which is reused.
+     */
+    void reset();
+
+    size_t bytes() const { return bytes_; }
+
+private:
+    void *allocateBytes(size_t size, size_t alignment);
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char *next_ = nullptr;
+    size_t left_ = 0;
+    size_t first_block_size_ = 0;
+    size_t bytes_ = 0;  // handed out since the last reset
+};
+
+#endif
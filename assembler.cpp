@@ -0,0 +1,1001 @@
+#include "assembler.hpp"
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "arena.hpp"
+#include "definitions.hpp"
+#include "instruction.hpp"
+#include "lexer.hpp"
+#include "passes.hpp"
+#include "program.hpp"
+#include "source.hpp"
+#include "stats.hpp"
+#include "threadpool.hpp"
+#include "trace.hpp"
+
+/**
+ * @brief Stores the address of a label. A label defined more than once keeps
+ * its last address, every redefinition is reported as a warning.
+ *
+ * @param symbols reference to the symbol table of the label addresses
+ * @param label label as written in the source, including the ':'
+ * @param hash labelHash of the label without the ':'
+ * @param address address of the label
+ * @param line 1-based source line of the definition
+ * @param warnings receives the warning for a redefinition
+ */
+void defineLabel(SymbolTable &symbols,
+                 std::string_view label,
+                 uint32_t hash,
+                 int address,
+                 size_t line,
+                 std::vector<Diagnostic> &warnings) {
+    const std::string_view name = label.substr(0, label.size() - 1);
+    if (!symbols.define(name, hash, address)) {
+        warnings.push_back({line, "Warning: label '" + std::string(name) + "' is defined more than once, the last definition is used.\n"});
+    }
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief First pass to find the addresses for each lable that occur.
+ *
+ * @param source contents of the file that contains the raw instructions
+ * @param symbols reference to the symbol table that will store the numerical
+ * addresses of each label
+ * @param warnings receives a warning for every label defined more than once
+ */
+void firstPass(std::string_view source, SymbolTable &symbols, std::vector<Diagnostic> &warnings) {
+    PhaseTimer timer(STATS_FIRST_PASS);
+    LineReader fileReader(source);
+    std::string_view currentLine;
+    size_t line_number = 0;
+    unsigned int addrPointer = 0;
+
+    while (fileReader.next(currentLine)) {
+        ++line_number;
+        const LineTokens tokens = lexLine(currentLine);
+        // Looking for lines with codes
+        if (tokens.has_code) {
+            // Looking for a label name (without the ':')
+            if (!tokens.label.empty()) {
+                defineLabel(symbols, tokens.label, tokens.label_hash, addrPointer, line_number, warnings);
+            }
+            if (!tokens.label_single) addrPointer += 4;
+        }
+    }
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Checks a decoded register and returns the numerical index of the
+ * corresponding register.
+ *
+ * @param s the register as written in the source. Must begin with '$'
+ * followed by either the numeric index or the alphanumerical abbreviation. E.g.
+ * "$14" or "$t1".
+ * @param code s decoded by decodeRegister
+ * @param errout Reference to the listing the error message will be printed
+ * to, it decides how numbers in the message are written.
+ * @return uint32_t the numerical index of the corresponding register. Throws
+ * an AssemblyError if s is no valid register.
+ */
+uint32_t regCode(std::string_view s, const RegisterCode &code, OutputBuffer &errout) {
+    switch (code.status) {
+        case REGISTER_INVALID:
+            throw AssemblyError("Error: Register string invalid: " + std::string(s) + ". Abort ...\n");
+
+        case REGISTER_OUT_OF_RANGE:
+            throw AssemblyError("Error: Register out of range: " + errout.integerString(code.number) + ". Abort ...\n");
+
+        case REGISTER_UNSUPPORTED:
+            throw AssemblyError("Error: Register abbreviation not supported: " + std::string(s) + ". Abort ...\n");
+
+        default:
+            return code.number;
+    }
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Returns the register an operand of the instruction names.
+ */
+uint32_t regCode(const Instruction &instruction, size_t part, OutputBuffer &errout) {
+    return regCode(instruction.parts[part], instruction.registers[part], errout);
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Returns the immediate of the instruction like stoi converted it, but
+ * reports a part that is no (representable) number as an AssemblyError.
+ *
+ * @param instruction the instruction
+ * @param part the part the immediate was read from
+ * @return int the immediate
+ */
+int toInt(const Instruction &instruction, size_t part) {
+    if (!instruction.immediate_valid) {
+        throw AssemblyError("Error: Number invalid: " + std::string(instruction.parts[part]) + ". Abort ...\n");
+    }
+    return instruction.immediate;
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Converts a MIPS instruction into its binary form.
+ *
+ * @param instruction a decoded MIPS instruction, e.g. "add $t2, $t1, $t1" is
+ * read as {"add", "$t2", "$t1", "$t1"} with the registers 10, 9 and 9
+ * @param errout Reference to the listing the error message will be printed
+ * to, it decides how numbers in the message are written.
+ * @return uint32_t binary MIPS instruction. Throws an AssemblyError if the
+ * instruction can't be converted.
+ */
+uint32_t binInstruction(const Instruction &instruction, OutputBuffer &errout) {
+    size_t argument_cnt = instruction.part_count;
+    if (argument_cnt == 0) {
+        throw AssemblyError("Error: Empty instruction can't be converted to binary. Abort ...\n");
+    }
+
+    if (instruction.exit) {
+        return ~0u;
+    }
+
+    // codes and layout for instruction
+    if (instruction.entry == nullptr) {
+        throw AssemblyError("Error: Instruction " + std::string(instruction.parts[0]) + " is not supported. Abort ...\n");
+    }
+    InstructionCodes instruction_codes = instruction.entry->codes;
+
+    // 1. op-code - first (left) 6 bits
+    uint32_t binary_instr = 0x00000000;
+    binary_instr |= instruction_codes.op_code << 26;
+
+    // 2. parse arguments
+    switch (instruction_codes.format) {
+        case INSTR_TYPE_R:
+            if (argument_cnt == 2) {  // jr instruction
+                binary_instr |= regCode(instruction, 1, errout) << 21;
+                binary_instr |= instruction_codes.function;
+                break;
+            }
+
+            if (argument_cnt != 4) {
+                throw AssemblyError("Error: Wrong amount of arguments for instruction type R: " + errout.integerString(argument_cnt) + ".\n");
+            }
+
+            binary_instr |= regCode(instruction, 2, errout) << 21;  // rs
+            binary_instr |= regCode(instruction, 3, errout) << 16;  // rt
+            binary_instr |= regCode(instruction, 1, errout) << 11;  // rd
+            binary_instr |= instruction_codes.function;  // func. code
+            break;
+
+        case INSTR_TYPE_R_SHIFT:
+            if (argument_cnt != 4) {
+                throw AssemblyError("Error: Wrong amount of arguments for instruction type R: " + errout.integerString(argument_cnt) + ".\n");
+            }
+
+            binary_instr |= regCode(instruction, 2, errout) << 16;  // rt
+            binary_instr |= regCode(instruction, 1, errout) << 11;  // rd
+            binary_instr |= static_cast<uint32_t>(toInt(instruction, 3)) << 6;  // sh
+            binary_instr |= instruction_codes.function;  // func. code
+            break;
+
+        case INSTR_TYPE_I:
+            if (argument_cnt != 4) {
+                throw AssemblyError("Error: Wrong amount of arguments for instruction type I: " + errout.integerString(argument_cnt) + ".\n");
+            }
+
+            if(toInt(instruction, 3) > 0xFFFF){
+                throw AssemblyError("Error: Argument too long.\n");
+            }
+
+            // format: {instr, rt, rs, imm} or {instr, rt, rs, offset}
+            binary_instr |= regCode(instruction, 2, errout) << 21;  // rs
+            binary_instr |= regCode(instruction, 1, errout) << 16;  // rt
+            binary_instr |= toInt(instruction, 3) & 0xFFFF;  // imm or offset
+            break;
+
+        case INSTR_TYPE_J:
+            if (argument_cnt != 2) {
+                throw AssemblyError("Error: Wrong amount of arguments for instruction type J: " + errout.integerString(argument_cnt) + ".\n");
+            }
+
+            if(toInt(instruction, 1) > 0x3FFFFFF){
+                throw AssemblyError("Error: Jump address too long.\n");
+            }
+
+            binary_instr |= toInt(instruction, 1) & 0x3FFFFFF;
+            break;
+
+        case INSTR_TYPE_NULL:
+        default:
+            binary_instr = 0u;
+            break;
+    }
+
+    return binary_instr;
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Writes the listing line of an encoded instruction.
+ *
+ * @param outputListing output file stream for the file containing the listing
+ * @param address address of the instruction
+ * @param binary_instruction the encoded instruction
+ * @param label label at the beginning of the line, empty if there is none
+ * @param parts mnemonic and operands as written
+ * @param part_count number of parts
+ * @param number_part part that is listed as number instead of its text, 0 if
+ * there is none
+ * @param number the number to list for number_part
+ * @param labelCall label a "j" or "beq" jumps to, empty if there is none
+ * @param comment comment of the line, empty if there is none
+ */
+void listInstruction(OutputBuffer &outputListing,
+                     int address,
+                     uint32_t binary_instruction,
+                     std::string_view label,
+                     const std::string_view *parts,
+                     size_t part_count,
+                     size_t number_part,
+                     int number,
+                     std::string_view labelCall,
+                     std::string_view comment) {
+    outputListing.setIntegerBase(16);
+    outputListing.write("0x");
+    outputListing.hex8(address);
+    outputListing.write("    0x");
+    outputListing.hex8(binary_instruction);
+    if (label.empty()) {
+        outputListing.fill(' ', 18);
+    } else {
+        outputListing.fill(' ', 4);
+        outputListing.padded(label, 10);
+        outputListing.fill(' ', 4);
+    }
+    if (parts[0] == "sw" || parts[0] == "lw") {
+        outputListing << parts[0] << " " << parts[1] << " " << parts[3] << "(" << parts[2] << ") ";
+    } else if (parts[0] == "j" && !labelCall.empty()) {
+        outputListing << parts[0] << " " << labelCall << " ";
+    } else if (parts[0] == "beq" && !labelCall.empty()) {
+        outputListing << parts[0] << " " << parts[2] << " " << parts[1] << " " << labelCall << " ";
+    } else {
+        for (size_t i = 0; i < part_count; ++i) {
+            // numeric targets of "j" and "beq" are listed as converted
+            if (i != 0 && i == number_part) {
+                outputListing.decimal(number);
+            } else {
+                outputListing.write(parts[i]);
+            }
+            outputListing.put(' ');
+        }
+    }
+    if (!comment.empty()) {
+        outputListing.fill(' ', 4);
+        outputListing.write(comment);
+    }
+    outputListing.put('\n');
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Writes the listing line of a line without instruction.
+ */
+void listLine(OutputBuffer &outputListing, std::string_view label, std::string_view comment) {
+    if (!label.empty() || !comment.empty()) {
+        outputListing.fill(' ', 28);
+    }
+    if (!label.empty()) {
+        outputListing.write(label);
+    }
+    if (!comment.empty()) {
+        if (!label.empty()) {
+            outputListing.fill(' ', 4);
+        }
+        outputListing.write(comment);
+    }
+    outputListing.put('\n');
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief outputPrinting generates the two output files after the execution
+ * of the second pass
+ *
+ * @param outputListing output file stream for the file containing the listing
+ * @param outputInstructions destination of the encoded instructions
+ * @param instruction the decoded MIPS instruction to handle
+ * @param comment contain the comment if there is one on the line
+ * @param label contain the label which is placed at the beginning of the line
+ * if there is one
+ * @param instruction_count contain the current instruction address
+ * @param labelSingle is true if a label is the only element on the line
+ * (doesn't take into account potential comment)
+ */
+void outputPrinting(OutputBuffer &outputListing,
+            InstructionOutput &outputInstructions,
+            const Instruction &instruction,
+            std::string_view comment,
+            std::string_view label,
+            int &instruction_count,
+            bool labelSingle) {
+    if (instruction.kind == INSTRUCTION_INVALID) {
+        throw AssemblyError("Error: Wrong amount of arguments, operation not supported.\n");
+    } else {
+        if (instruction.kind == INSTRUCTION_CODE) {
+            uint32_t binary_instruction = binInstruction(instruction, outputListing);
+
+            // output listing
+            listInstruction(outputListing, instruction_count, binary_instruction, label, instruction.parts,
+                            instruction.part_count, instruction.number_part, instruction.immediate,
+                            instruction.jump_label, comment);
+
+            // output instructions
+            outputInstructions.add(binary_instruction);
+            if (!labelSingle) instruction_count += 4;
+        } else {
+            listLine(outputListing, label, comment);
+        }
+    }
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief outputPrinting without a listing, only the encoded instruction is
+ * written.
+ *
+ * @param errout the listing that isn't written, it decides how numbers in
+ * error messages are written
+ */
+void outputInstruction(OutputBuffer &errout,
+                       InstructionOutput &outputInstructions,
+                       const Instruction &instruction,
+                       int &instruction_count,
+                       bool labelSingle) {
+    if (instruction.kind == INSTRUCTION_INVALID) {
+        throw AssemblyError("Error: Wrong amount of arguments, operation not supported.\n");
+    }
+    if (instruction.kind != INSTRUCTION_CODE) return;
+    outputInstructions.add(binInstruction(instruction, errout));
+    // the listing would have switched to hex here
+    errout.setIntegerBase(16);
+    if (!labelSingle) instruction_count += 4;
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief symbolsOutputPrinting print the symbols at the ends of the listing
+ * file when the outputPrinting function has finished
+ *
+ * @param outputListing output file stream for the file containing the listing
+ * @param symbols reference to a symbol table that holds the numerical
+ * addresses of each label
+ */
+void symbolsOutputPrinting(OutputBuffer &outputListing, SymbolTable &symbols) {
+    PhaseTimer timer(STATS_SYMBOLS);
+    outputListing.write("\nSymbols\n");
+    symbols.sort();
+    for (const auto &lbl: symbols.symbols()) {
+        outputListing.padded(lbl.name, 13);
+        outputListing.write(" 0x");
+        outputListing.hex8(lbl.address);
+        outputListing.put('\n');
+    }
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Fills in the address of the label a "j" or "beq" jumps to.
+ *
+ * @param instruction instruction as returned by parseInstruction
+ * @param labelAddr address of the label
+ * @param instruction_count address of the instruction itself
+ */
+void resolveLabel(Instruction &instruction, int labelAddr, int instruction_count) {
+    if (instruction.parts[0] == "j") {
+        instruction.immediate = labelAddr / 4;
+    } else {
+        instruction.immediate = (labelAddr - instruction_count - 4) / 4;
+    }
+    instruction.immediate_valid = true;
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Validates, converts and prints a single line, the way the second
+ * pass did it line by line. Used for the line the program arrays stop at,
+ * since it knows the exact error message.
+ *
+ * @param tokens the lexed line
+ * @param instruction scratch space for the decoded instruction
+ * @param instruction_count address of the instruction on the line
+ */
+void encodeLine(const LineTokens &tokens,
+                Instruction &instruction,
+                int &instruction_count,
+                OutputBuffer &outputListing,
+                InstructionOutput &outputInstructions,
+                const SymbolTable &symbols) {
+    if (!parseInstruction(tokens, instruction)) {
+        throw AssemblyError("Error: Argument too long.\n");
+    }
+    if (!instruction.jump_label.empty()) {
+        const int *labelAddr = symbols.find(instruction.jump_label, instruction.jump_hash);
+        if (labelAddr == nullptr) {
+            throw AssemblyError("Error: label '" + std::string(instruction.jump_label) + "' does not exist!\n");
+        }
+        resolveLabel(instruction, *labelAddr, instruction_count);
+    }
+    outputPrinting(outputListing, outputInstructions, instruction, tokens.comment, tokens.label, instruction_count, tokens.label_single);
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Fills in the addresses of the labels every "j" and "beq" of the
+ * program jumps to.
+ *
+ * @return size_t first line that names a label that doesn't exist,
+ * program.line_count if all exist
+ */
+size_t resolveProgramLabels(Program &program, const SymbolTable &symbols) {
+    for (size_t i = 0; i < program.instruction_count; ++i) {
+        if ((program.flags[i] & INSTRUCTION_JUMPS_TO_LABEL) == 0) continue;
+        const bool jump = program.part_count[i] == 2;  // "j", otherwise "beq"
+        const int *labelAddr = symbols.find(program.parts[4 * i + (jump ? 1 : 3)], program.jump_hash[i]);
+        if (labelAddr == nullptr) {
+            program.flags[i] |= INSTRUCTION_FAILS;
+            return program.line[i];
+        }
+        program.immediate[i] = jump ? *labelAddr / 4 : (*labelAddr - program.address[i] - 4) / 4;
+        program.flags[i] |= INSTRUCTION_NUMBER_VALID;
+    }
+    return program.line_count;
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Encodes instruction i of the program, like binInstruction but
+ * without error messages.
+ *
+ * @return bool false if binInstruction would report an error
+ */
+bool encodeWord(const Program &program, size_t i, uint32_t &word) {
+    const uint8_t opcode = program.opcode[i];
+    if (opcode == OPCODE_EXIT) {
+        word = ~0u;
+        return true;
+    }
+    if (opcode == OPCODE_UNKNOWN) return false;
+
+    const InstructionCodes &codes = INSTR_CODES[opcode].codes;
+    const size_t count = program.part_count[i];
+    const bool number = (program.flags[i] & INSTRUCTION_NUMBER_VALID) != 0;
+    const int immediate = program.immediate[i];
+    const uint32_t rs = program.rs[i], rt = program.rt[i], rd = program.rd[i];
+    word = codes.op_code << 26;
+    switch (codes.format) {
+        case INSTR_TYPE_R:
+            if (count == 2) {  // jr instruction
+                if (rs == REGISTER_NONE) return false;
+                word |= rs << 21 | codes.function;
+                return true;
+            }
+            if (count != 4 || rs == REGISTER_NONE || rt == REGISTER_NONE || rd == REGISTER_NONE) return false;
+            word |= rs << 21 | rt << 16 | rd << 11 | codes.function;
+            return true;
+
+        case INSTR_TYPE_R_SHIFT:
+            if (count != 4 || rt == REGISTER_NONE || rd == REGISTER_NONE || !number) return false;
+            word |= rt << 16 | rd << 11 | static_cast<uint32_t>(immediate) << 6 | codes.function;
+            return true;
+
+        case INSTR_TYPE_I:
+            if (count != 4 || !number || immediate > 0xFFFF || rs == REGISTER_NONE || rt == REGISTER_NONE) return false;
+            word |= rs << 21 | rt << 16 | (immediate & 0xFFFF);
+            return true;
+
+        case INSTR_TYPE_J:
+            if (count != 2 || !number || immediate > 0x3FFFFFF) return false;
+            word |= immediate & 0x3FFFFFF;
+            return true;
+
+        default:
+            word = 0u;
+            return true;
+    }
+}
+
+/**
+ * @brief Encodes all instructions of the program.
+ *
+ * @return size_t first line with an instruction that can't be encoded,
+ * program.line_count if all can
+ */
+size_t encodeProgram(Program &program) {
+    for (size_t i = 0; i < program.instruction_count; ++i) {
+        if (!encodeWord(program, i, program.word[i])) {
+            program.flags[i] |= INSTRUCTION_FAILS;
+            return program.line[i];
+        }
+    }
+    return program.line_count;
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Lists the lines of the program in front of end_line.
+ */
+void listProgram(const Program &program, size_t end_line, OutputBuffer &outputListing) {
+    size_t i = 0;  // next instruction
+    for (size_t line = 0; line < end_line; ++line) {
+        if (program.line_kind[line] != PROGRAM_LINE_INSTRUCTION) {
+            listLine(outputListing, program.label[line], program.comment[line]);
+            continue;
+        }
+        const std::string_view *parts = program.parts + 4 * i;
+        const size_t count = program.part_count[i];
+        const size_t number_part = (program.flags[i] & INSTRUCTION_NUMBER_LISTED) == 0 ? 0 : count == 2 ? 1 : 3;
+        const std::string_view labelCall = (program.flags[i] & INSTRUCTION_JUMPS_TO_LABEL) == 0 ? std::string_view()
+                                           : parts[count == 2 ? 1 : 3];
+        listInstruction(outputListing, program.address[i], program.word[i], program.label[line], parts, count,
+                        number_part, program.immediate[i], labelCall, program.comment[line]);
+        ++i;
+    }
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Validates, converts and prints the lines of text, the work of the
+ * second pass. The text is read into a Program, whose labels are resolved,
+ * whose instructions are encoded and which is listed, each in a loop of its
+ * own. The text can be a piece of the source, then first_line and
+ * instruction_count say where in the source it starts.
+ *
+ * @param text lines to assemble
+ * @param first_line number of source lines before text
+ * @param instruction_count address of the first instruction in text
+ * @param outputListing output file stream for the file containing the listing
+ * @param outputInstructions destination of the encoded instructions
+ * @param symbols reference to a symbol table that holds the numerical
+ * addresses of each label
+ * @param listing false skips the listing, outputListing only decides how
+ * numbers in error messages are written
+ * @param wall false times the encoding and listing as CPU time only, for text
+ * that is one of several chunks on the worker threads
+ */
+void encodeLines(std::string_view text,
+                 size_t first_line,
+                 int instruction_count,
+                 OutputBuffer &outputListing,
+                 InstructionOutput &outputInstructions,
+                 const SymbolTable &symbols,
+                 bool listing,
+                 bool wall) {
+    Arena arena;
+    Program program;
+    size_t error_line = buildProgram(program, arena, text, instruction_count, listing);
+    error_line = std::min(error_line, resolveProgramLabels(program, symbols));
+    {
+        PhaseTimer timer(STATS_ENCODE, wall);
+        error_line = std::min(error_line, encodeProgram(program));
+    }
+
+    // everything in front of the first error is written
+    if (listing) {
+        PhaseTimer timer(STATS_LISTING, wall);
+        listProgram(program, error_line, outputListing);
+    }
+    size_t i = 0;
+    for (; i < program.instruction_count && program.line[i] < error_line; ++i) {
+        outputInstructions.add(program.word[i]);
+    }
+    if (error_line == program.line_count) return;
+    // the listing would have switched to hex with the first instruction
+    if (!listing && i > 0) outputListing.setIntegerBase(16);
+
+    // the line with the error throws the message the line by line pass gives
+    int address = i < program.instruction_count ? program.address[i] : 0;
+    Instruction instruction;
+    try {
+        encodeLine(lexLine(programLine(program, error_line)), instruction, address, outputListing, outputInstructions, symbols);
+    } catch (AssemblyError &error) {
+        error.line = first_line + error_line + 1;
+        throw;
+    }
+}
+
+// --------------------------------------------------------
+
+// smallest piece of the source worth assembling on its own thread
+constexpr size_t MIN_CHUNK_BYTES = 1 << 18;
+
+// a label found by scanChunk, relative to the start of its chunk
+struct ChunkLabel {
+    std::string_view label;  // points into the source, including the ':'
+    uint32_t hash;           // labelHash of the label without the ':'
+    unsigned int offset;     // address relative to the chunk
+    size_t line;             // line relative to the chunk, 1-based
+};
+
+// a piece of the source that both passes work on in parallel to the others
+struct SourceChunk {
+    std::string_view text;
+    size_t lines = 0;               // number of lines in text
+    unsigned int addresses = 0;     // bytes the first pass counts for text
+    int instructions = 0;           // bytes the second pass counts for text
+    bool lists_instruction = false; // text lists at least one instruction
+    std::vector<ChunkLabel> labels; // in source order
+    std::string listing;
+    std::vector<uint32_t> words;
+    bool failed = false;
+    std::string error;              // message of the first error in text
+    size_t error_line = 0;
+};
+
+/**
+ * @brief Splits the source into chunks for the threads.
+ *
+ * @return std::vector<SourceChunk> the chunks, a single one if the source is
+ * too small to be worth splitting
+ */
+std::vector<SourceChunk> sourceChunks(std::string_view source, size_t threads) {
+    const size_t count = threads > 1 ? std::min(threads * 4, source.size() / MIN_CHUNK_BYTES) : 1;
+    std::vector<SourceChunk> chunks;
+    for (std::string_view text: splitChunks(source, count)) {
+        chunks.emplace_back();
+        chunks.back().text = text;
+    }
+    return chunks;
+}
+
+/**
+ * @brief Reads a chunk once and collects what the chunks behind it depend on:
+ * its lines, its labels and how far it moves the addresses of both passes.
+ * The second pass doesn't count lines that stop the assembly, nothing after
+ * them is written anyway.
+ */
+void scanChunk(SourceChunk &chunk) {
+    LineReader fileReader(chunk.text);
+    std::string_view currentLine;
+    while (fileReader.next(currentLine)) {
+        ++chunk.lines;
+        const LineTokens tokens = lexLine(currentLine);
+        if (tokens.has_code) {
+            if (!tokens.label.empty()) {
+                chunk.labels.push_back({tokens.label, tokens.label_hash, chunk.addresses, chunk.lines});
+            }
+            if (!tokens.label_single) chunk.addresses += 4;
+        }
+        if (tokens.shape >= LINE_SHAPE_ONE && tokens.shape <= LINE_SHAPE_THREE) {
+            chunk.lists_instruction = true;
+            if (!tokens.label_single) chunk.instructions += 4;
+        }
+    }
+}
+
+/**
+ * @brief First pass over scanned chunks: the chunk addresses are summed up in
+ * source order and the labels of every chunk are moved to their absolute
+ * address. The result is the same as the one of firstPass.
+ */
+void chunkLabels(const std::vector<SourceChunk> &chunks,
+                 SymbolTable &symbols,
+                 std::vector<Diagnostic> &warnings) {
+    size_t first_line = 0;
+    unsigned int addrPointer = 0;
+    for (const auto &chunk: chunks) {
+        for (const auto &label: chunk.labels) {
+            defineLabel(symbols, label.label, label.hash, addrPointer + label.offset, first_line + label.line, warnings);
+        }
+        first_line += chunk.lines;
+        addrPointer += chunk.addresses;
+    }
+}
+
+/**
+ * @brief Second pass over scanned chunks. The chunks are encoded in parallel
+ * into buffers of their own, which are written out in source order. The
+ * output is the same as the one of secondPass, including the listing up to an
+ * error.
+ */
+void encodeChunks(std::vector<SourceChunk> &chunks,
+                  ThreadPool &pool,
+                  OutputBuffer &outputListing,
+                  InstructionOutput &outputInstructions,
+                  const SymbolTable &symbols,
+                  bool listing) {
+    size_t first_line = 0;
+    int instruction_count = 0;
+    bool listed_before = false;
+    for (size_t index = 0; index < chunks.size(); ++index) {
+        SourceChunk &chunk = chunks[index];
+        pool.submit([&chunk, &symbols, index, first_line, instruction_count, listed_before, listing] {
+            PhaseTimer timer(STATS_SECOND_PASS, false);
+            TraceSpan span("encodeChunk", "chunk", std::to_string(index));
+            OutputBuffer listing_buffer;
+            listing_buffer.openString(chunk.listing);
+            // numbers in error messages are hex once an instruction was listed
+            if (listed_before) listing_buffer.setIntegerBase(16);
+            InstructionOutput instructions(chunk.words);
+            try {
+                encodeLines(chunk.text, first_line, instruction_count, listing_buffer, instructions, symbols, listing,
+                            false);
+            } catch (const AssemblyError &error) {
+                chunk.failed = true;
+                chunk.error = error.what();
+                chunk.error_line = error.line;
+            }
+            listing_buffer.close();
+        });
+        first_line += chunk.lines;
+        instruction_count += chunk.instructions;
+        listed_before = listed_before || chunk.lists_instruction;
+    }
+    pool.wait();
+
+    for (const auto &chunk: chunks) {
+        outputListing.write(chunk.listing);
+        for (uint32_t word: chunk.words) outputInstructions.add(word);
+        if (chunk.failed) {
+            AssemblyError error(chunk.error);
+            error.line = chunk.error_line;
+            throw error;
+        }
+    }
+}
+
+/**
+ * @brief Both passes over a source split into chunks, on several threads.
+ * Every chunk is read once to find its labels and counts, then encoded.
+ *
+ * @param chunks the source split at line breaks
+ * @param threads number of worker threads
+ * @param listing false writes only the instructions
+ */
+void chunkedPasses(std::vector<SourceChunk> &chunks,
+                   size_t threads,
+                   OutputBuffer &outputListing,
+                   InstructionOutput &outputInstructions,
+                   SymbolTable &symbols,
+                   std::vector<Diagnostic> &warnings,
+                   bool listing) {
+    ThreadPool pool(threads);
+    {
+        PhaseTimer timer(STATS_FIRST_PASS);
+        for (size_t index = 0; index < chunks.size(); ++index) {
+            SourceChunk &chunk = chunks[index];
+            pool.submit([&chunk, index] {
+                PhaseTimer timer(STATS_FIRST_PASS, false);
+                TraceSpan span("scanChunk", "chunk", std::to_string(index));
+                scanChunk(chunk);
+            });
+        }
+        pool.wait();
+        chunkLabels(chunks, symbols, warnings);
+    }
+
+    PhaseTimer timer(STATS_SECOND_PASS);
+    encodeChunks(chunks, pool, outputListing, outputInstructions, symbols, listing);
+    if (listing) symbolsOutputPrinting(outputListing, symbols);
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Second pass to validate the instructions, handle comments, split the
+ * instructions into their parts and eventually convert and print them.
+ *
+ * @param source contents of the file that contains the raw instructions
+ * @param outputListing output file stream for the file containing the listing
+ * @param outputInstructions destination of the encoded instructions
+ * @param symbols reference to a symbol table that holds the numerical
+ * addresses of each label
+ * @param listing false writes only the instructions, without comments,
+ * listing and symbols
+ */
+void secondPass(std::string_view source,
+                OutputBuffer &outputListing,
+                InstructionOutput &outputInstructions,
+                SymbolTable &symbols,
+                bool listing) {
+    PhaseTimer timer(STATS_SECOND_PASS);
+    encodeLines(source, 0, 0, outputListing, outputInstructions, symbols, listing);
+    if (listing) symbolsOutputPrinting(outputListing, symbols);
+}
+
+// --------------------------------------------------------
+
+// a line read by onePass, kept until all labels are known
+struct PendingLine {
+    Instruction instruction;
+    std::string_view comment;  // points into the source
+    std::string_view label;    // points into the source
+    bool labelSingle = false;
+    bool resolved = true;
+    std::string error;  // message secondPass would print for this line
+};
+
+// a "j" or "beq" that names a label
+struct Fixup {
+    size_t line;            // index into the pending lines
+    int instruction_count;  // address of the instruction
+};
+
+/**
+ * @brief Assembles the input in a single pass. Every line is read and split
+ * only once. A "j" or "beq" that names a label records a fixup which is
+ * patched as soon as the label is defined. Since a label defined several
+ * times resolves to its last definition, fixups are kept and patched again on
+ * every redefinition. The output is the same as the one of firstPass followed
+ * by secondPass.
+ *
+ * @param source contents of the file that contains the raw instructions
+ * @param outputListing output file stream for the file containing the listing
+ * @param outputInstructions destination of the encoded instructions
+ * @param symbols reference to the symbol table that will store the numerical
+ * addresses of each label
+ * @param warnings receives a warning for every label defined more than once
+ * @param listing false writes only the instructions
+ */
+void onePass(std::string_view source,
+             OutputBuffer &outputListing,
+             InstructionOutput &outputInstructions,
+             SymbolTable &symbols,
+             std::vector<Diagnostic> &warnings,
+             bool listing) {
+    std::optional<PhaseTimer> timer(std::in_place, STATS_FIRST_PASS);
+    std::map<std::string, std::vector<Fixup>, std::less<>> fixups;
+    std::vector<PendingLine> lines;
+    LineReader fileReader(source);
+    std::string_view currentLine;
+    unsigned int addrPointer = 0;
+    int instruction_count = 0;
+
+    while (fileReader.next(currentLine)) {
+        const LineTokens tokens = lexLine(currentLine, listing);
+        PendingLine line;
+        line.labelSingle = tokens.label_single;
+        line.comment = tokens.comment;
+        line.label = tokens.label;
+
+        if (tokens.has_code) {
+            if (!tokens.label.empty()) {
+                defineLabel(symbols, tokens.label, tokens.label_hash, addrPointer, lines.size() + 1, warnings);
+                // patch everything that jumps to this label so far
+                const auto waiting = fixups.find(tokens.label.substr(0, tokens.label.size() - 1));
+                if (waiting != fixups.end()) {
+                    for (const auto &fixup: waiting->second) {
+                        resolveLabel(lines[fixup.line].instruction, addrPointer, fixup.instruction_count);
+                        lines[fixup.line].resolved = true;
+                    }
+                }
+            }
+            if (!tokens.label_single) addrPointer += 4;
+        }
+
+        if (!parseInstruction(tokens, line.instruction)) {
+            line.error = "Error: Argument too long.\n";
+        } else if (!line.instruction.jump_label.empty()) {
+            const std::string_view labelCall = line.instruction.jump_label;
+            auto waiting = fixups.find(labelCall);
+            if (waiting == fixups.end()) {
+                waiting = fixups.emplace(std::string(labelCall), std::vector<Fixup>()).first;
+            }
+            waiting->second.push_back({lines.size(), instruction_count});
+            const int *labelAddr = symbols.find(labelCall, line.instruction.jump_hash);
+            if (labelAddr != nullptr) {
+                resolveLabel(line.instruction, *labelAddr, instruction_count);
+            } else {
+                line.resolved = false;
+            }
+        }
+        if (line.instruction.kind != INSTRUCTION_NONE && !line.labelSingle) instruction_count += 4;
+        lines.push_back(std::move(line));
+    }
+
+    timer.reset();
+    timer.emplace(STATS_SECOND_PASS);
+
+    // end of input: whatever is still open names a label that doesn't exist
+    instruction_count = 0;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        PendingLine &line = lines[i];
+        try {
+            if (line.error.empty() && !line.resolved) {
+                line.error = "Error: label '" + std::string(line.instruction.jump_label) + "' does not exist!\n";
+            }
+            if (!line.error.empty()) {
+                throw AssemblyError(line.error);
+            }
+            if (listing) {
+                outputPrinting(outputListing, outputInstructions, line.instruction, line.comment, line.label, instruction_count, line.labelSingle);
+            } else {
+                outputInstruction(outputListing, outputInstructions, line.instruction, instruction_count, line.labelSingle);
+            }
+        } catch (AssemblyError &error) {
+            error.line = i + 1;
+            throw;
+        }
+    }
+    if (listing) symbolsOutputPrinting(outputListing, symbols);
+}
+
+// --------------------------------------------------------
+
+AssemblyResult assemble(std::string_view source,
+                        const AssemblyOptions &options,
+                        OutputBuffer &listing,
+                        InstructionOutput &instructions) {
+    AssemblyResult result;
+    SymbolTable symbols;
+    try {
+        if (options.one_pass) {
+            onePass(source, listing, instructions, symbols, result.warnings, options.listing);
+        } else {
+            const size_t threads = ThreadPool::threadCount(options.jobs);
+            std::vector<SourceChunk> chunks = sourceChunks(source, threads);
+            if (chunks.size() > 1) {
+                chunkedPasses(chunks, threads, listing, instructions, symbols, result.warnings, options.listing);
+            } else {
+                firstPass(source, symbols, result.warnings);
+                secondPass(source, listing, instructions, symbols, options.listing);
+            }
+        }
+        instructions.finish();
+        result.ok = true;
+    } catch (const AssemblyError &error) {
+        // the listing ends with the error, like it always did
+        if (options.listing) listing.write(error.what());
+        result.diagnostics.push_back({error.line, error.what()});
+    }
+    if (statsEnabled()) {
+        addStat(STATS_LINES, std::count(source.begin(), source.end(), '\n') + (!source.empty() && source.back() != '\n'));
+        addStat(STATS_INSTRUCTIONS, instructions.count());
+        addStat(STATS_LABELS, symbols.size());
+    }
+
+    symbols.sort();
+    result.symbols.reserve(symbols.size());
+    for (const auto &lbl: symbols.symbols()) {
+        result.symbols.push_back({std::string(lbl.name), lbl.address});
+    }
+    return result;
+}
+
+// --------------------------------------------------------
+
+AssemblyResult assemble(std::string_view source, const AssemblyOptions &options) {
+    std::string listing_text;
+    std::vector<uint32_t> words;
+    OutputBuffer listing;
+    listing.openString(listing_text);
+    InstructionOutput instructions(words);
+
+    AssemblyResult result = assemble(source, options, listing, instructions);
+    listing.close();
+    result.listing = std::move(listing_text);
+    result.words = std::move(words);
+    return result;
+}
@@ -0,0 +1,76 @@
+#ifndef MIPS_ASSEMBLER_H
+#define MIPS_ASSEMBLER_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "output.hpp"
+
+struct AssemblyOptions {
+    bool one_pass = false;  // read and split every line only once
+    size_t jobs = 1;        // threads for both passes, 0 for one per core
+    bool listing = true;    // false only encodes: no listing, symbols or comments
+};
+
+struct Diagnostic {
+    size_t line = 0;      // 1-based source line, 0 if not tied to a line
+    std::string message;  // as written to the listing, e.g. "Error: ...\n"
+};
+
+struct Symbol {
+    std::string name;
+    int address = 0;
+};
+
+struct AssemblyResult {
+    bool ok = false;
+    std::vector<uint32_t> words;          // encoded instructions
+    std::string listing;                  // listing including the symbols
+    std::vector<Symbol> symbols;          // sorted by name
+    std::vector<Diagnostic> diagnostics;  // the error that stopped assembly
+    std::vector<Diagnostic> warnings;     // e.g. labels defined more than once
+};
+
+/**
+ * @brief Error that stops the assembly. Thrown inside the assembler and
+ * turned into a Diagnostic by assemble(), it never leaves the library.
+ */
+class AssemblyError : public std::runtime_error {
+public:
+    explicit AssemblyError(const std::string &message) : std::runtime_error(message) {}
+
+    size_t line = 0;
+};
+
+/**
+ * @brief Assembles a program completely in memory. Never exits the process,
+ * errors are reported in the diagnostics and at the end of the listing, just
+ * like the command line tool writes them into the listing file.
+ *
+ * @param source the raw instructions
+ * @param options how to assemble
+ * @return AssemblyResult instructions, listing, symbols and diagnostics
+ */
+AssemblyResult assemble(std::string_view source, const AssemblyOptions &options = {});
+
+/**
+ * @brief Assembles a program and writes listing and instructions to the given
+ * outputs while assembling, so large programs aren't held in memory twice.
+ *
+ * @param source the raw instructions
+ * @param options how to assemble
+ * @param listing output for the listing, gets nothing without
+ * options.listing
+ * @param instructions output for the encoded instructions
+ * @return AssemblyResult symbols and diagnostics, words and listing are empty
+ * since they went to the outputs
+ */
+AssemblyResult assemble(std::string_view source,
+                        const AssemblyOptions &options,
+                        OutputBuffer &listing,
+                        InstructionOutput &instructions);
+
+#endif
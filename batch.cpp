@@ -0,0 +1,112 @@
+#include "batch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <unordered_map>
+
+#include "cache.hpp"
+#include "source.hpp"
+#include "stats.hpp"
+#include "threadpool.hpp"
+#include "trace.hpp"
+
+std::vector<BatchJob> batchJobs(const std::vector<std::string> &sources, const std::string &output_dir, int format) {
+    const char *extension = format == OUTPUT_FORMAT_BIN ? ".bin" : ".hex";
+    std::vector<BatchJob> jobs;
+    jobs.reserve(sources.size());
+    for (const auto &source: sources) {
+        const size_t slash = source.find_last_of('/');
+        const std::string name = slash == std::string::npos ? source : source.substr(slash + 1);
+        const std::string base = output_dir + "/" + name;
+        jobs.push_back({source, base + ".lst", base + extension});
+    }
+    return jobs;
+}
+
+bool findDuplicateOutputs(const std::vector<BatchJob> &jobs, size_t &first, size_t &second) {
+    // the listing is named like the instruction file
+    std::unordered_map<std::string, size_t> owners;
+    owners.reserve(jobs.size());
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const auto inserted = owners.emplace(jobs[i].instructions, i);
+        if (!inserted.second) {
+            first = inserted.first->second;
+            second = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool closeOutputs(const BatchJob &job, OutputBuffer &listing, OutputBuffer &instructions, AssemblyResult &result) {
+    bool written = true;
+    for (auto [output, path]: {std::pair{&listing, &job.listing}, std::pair{&instructions, &job.instructions}}) {
+        if (output->close()) continue;
+        result.ok = false;
+        result.diagnostics.push_back(
+            {0, "Error: " + *path + " could not be written: " + std::strerror(output->error()) + "\n"});
+        written = false;
+    }
+    return written;
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Assembles one program of a batch.
+ */
+AssemblyResult assembleJob(const BatchJob &job, const BatchOptions &options) {
+    TraceSpan span("assembleJob", "source", job.source);
+    SourceFile fileReader;
+    OutputBuffer outputListing;
+    OutputBuffer outputInstructions;
+    bool opened;
+    {
+        PhaseTimer timer(STATS_READ);
+        opened = fileReader.open(job.source);
+    }
+    if (!opened) {
+        AssemblyResult result;
+        result.diagnostics.push_back({0, "Error: File could not be opened: " + job.source + "\n"});
+        return result;
+    }
+    std::string cache_key;
+    if (!options.cache_dir.empty()) {
+        cache_key = cacheKey(fileReader.contents(), options);
+        AssemblyResult result;
+        if (loadCached(options.cache_dir, cache_key, job, result)) return result;
+    }
+    if ((options.assembly.listing && !outputListing.open(job.listing)) || !outputInstructions.open(job.instructions)) {
+        AssemblyResult result;
+        result.diagnostics.push_back({0, "Error: Output could not be created for: " + job.source + "\n"});
+        return result;
+    }
+
+    InstructionOutput instructions(outputInstructions, options.format, options.big_endian);
+    AssemblyResult result = assemble(fileReader.contents(), options.assembly, outputListing, instructions);
+    if (closeOutputs(job, outputListing, outputInstructions, result) && !cache_key.empty()) {
+        storeCached(options.cache_dir, cache_key, job, result);
+    }
+    return result;
+}
+
+// --------------------------------------------------------
+
+std::vector<AssemblyResult> assembleBatch(const std::vector<BatchJob> &jobs, const BatchOptions &options) {
+    std::vector<AssemblyResult> results(jobs.size());
+    ThreadPool pool(std::min(ThreadPool::threadCount(options.jobs), std::max<size_t>(jobs.size(), 1)));
+
+    // every worker takes the next job until none are left, instead of one
+    // task per job
+    std::atomic<size_t> next_job{0};
+    for (size_t worker = 0; worker < pool.size(); ++worker) {
+        pool.submit([&]() {
+            for (size_t i = next_job++; i < jobs.size(); i = next_job++) {
+                results[i] = assembleJob(jobs[i], options);
+            }
+        });
+    }
+    pool.wait();
+    return results;
+}
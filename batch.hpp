@@ -0,0 +1,65 @@
+#ifndef MIPS_BATCH_H
+#define MIPS_BATCH_H
+
+#include <string>
+#include <vector>
+
+#include "assembler.hpp"
+
+struct BatchOptions {
+    AssemblyOptions assembly;
+    int format = OUTPUT_FORMAT_HEX;  // format of the instruction files
+    bool big_endian = true;          // byte order of OUTPUT_FORMAT_BIN
+    size_t jobs = 0;                 // worker threads, 0 for one per core
+    std::string cache_dir;           // cache of assembled programs, empty for none
+    std::string incremental_state;   // state file of incremental runs, empty for none
+};
+
+// one program of a batch with its outputs
+struct BatchJob {
+    std::string source;
+    std::string listing;
+    std::string instructions;
+};
+
+/**
+ * @brief Jobs for every source: the outputs are written into output_dir and
+ * named after the source file, "prog.s" gets "prog.s.lst" and "prog.s.hex"
+ * (or "prog.s.bin" for OUTPUT_FORMAT_BIN).
+ *
+ * @param sources paths of the programs
+ * @param output_dir directory for listings and instruction files
+ * @param format OUTPUT_FORMAT_HEX or OUTPUT_FORMAT_BIN
+ */
+std::vector<BatchJob> batchJobs(const std::vector<std::string> &sources, const std::string &output_dir, int format);
+
+/**
+ * @brief Closes the outputs of a job. A write that failed fails the result
+ * with an "Error: ... could not be written" diagnostic on line 0.
+ *
+ * @return bool false if a write failed
+ */
+bool closeOutputs(const BatchJob &job, OutputBuffer &listing, OutputBuffer &instructions, AssemblyResult &result);
+
+/**
+ * @brief Finds two jobs that would write the same outputs, like "a/prog.s" and
+ * "b/prog.s" in one output directory.
+ *
+ * @param first receives the earlier of the two jobs
+ * @param second receives the later one
+ * @return bool false if every job has its own outputs
+ */
+bool findDuplicateOutputs(const std::vector<BatchJob> &jobs, size_t &first, size_t &second);
+
+/**
+ * @brief Assembles many programs concurrently on a pool of worker threads.
+ * Every program is assembled independently, with its own outputs.
+ *
+ * @param jobs programs to assemble
+ * @param options how to assemble and write them
+ * @return std::vector<AssemblyResult> one result per job in the same order.
+ * Sources or outputs that can't be opened are reported as a diagnostic.
+ */
+std::vector<AssemblyResult> assembleBatch(const std::vector<BatchJob> &jobs, const BatchOptions &options);
+
+#endif
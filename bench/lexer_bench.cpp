@@ -0,0 +1,140 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "lexer.hpp"
+
+/**
+ * @brief Splits a line the way secondPass did before lexLine existed. Kept
+ * here as the baseline for the comparison.
+ *
+ * @return size_t total length of the captured parts, so the work can't be
+ * optimized away
+ */
+size_t regexSplit(const std::string &currentLine) {
+    static const std::regex regex1(R"(.*(#.*))");
+    static const std::regex regex2((R"(^\s*[^\s#]+\s*#*)"));
+    static const std::regex regex3("[^#]*");
+    static const std::regex regex4((R"(\S*:)"));
+    static const std::regex regex5(":[^#]*[^#\\s]#*");
+    static const std::regex regex6(R"(\S*:)");
+    static const std::regex firstMatch(R"(^\s*(\S+)\s*$)");
+    static const std::regex secondMatch(R"(^\s*(\S+)\s+(\S+)\s*$)");
+    static const std::regex thirdMatch(R"(^\s*(\S+)\s+(\S+),\s*(\d+)\((\S+)\)\s*$)");
+    static const std::regex fourthMatch(R"(^\s*(\S+)\s+(\S+),\s*(\S+),\s*(\S+)\s*$)");
+
+    std::smatch match;
+    size_t length = 0;
+    if (std::regex_search(currentLine, match, regex1)) {
+        length += match.str(1).size();
+    }
+    if (std::regex_search(currentLine, regex2) && std::regex_search(currentLine, match, regex3)) {
+        std::string lineWithoutComments = match.str(0);
+        if (std::regex_search(lineWithoutComments, match, regex4)) {
+            length += match.str(0).size();
+            length += std::regex_search(lineWithoutComments, regex5);
+            lineWithoutComments = std::regex_replace(lineWithoutComments, regex6, "");
+        }
+        if (std::regex_search(lineWithoutComments, match, firstMatch) ||
+            std::regex_search(lineWithoutComments, match, secondMatch) ||
+            std::regex_search(lineWithoutComments, match, thirdMatch) ||
+            std::regex_search(lineWithoutComments, match, fourthMatch)) {
+            for (size_t i = 1; i < match.size(); ++i) length += match.str(i).size();
+        }
+    }
+    return length;
+}
+
+size_t lexerSplit(const std::string &currentLine) {
+    const LineTokens tokens = lexLine(currentLine);
+    size_t length = tokens.comment.size() + tokens.label.size() + tokens.label_single;
+    for (const auto &field: tokens.fields) length += field.size();
+    return length;
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Generates a program with the given amount of lines that uses every
+ * layout the assembler knows, labels and comments.
+ */
+std::vector<std::string> syntheticProgram(size_t line_count) {
+    static const char *const regs[] = {"$t0", "$t1", "$s0", "$s1", "$a0", "$zero", "$ra", "$17"};
+    std::mt19937 rng(42);
+    auto reg = [&]() { return std::string(regs[rng() % 8]); };
+
+    std::vector<std::string> lines;
+    lines.reserve(line_count);
+    for (size_t i = 0; i < line_count; ++i) {
+        std::string line;
+        if (i % 16 == 0) line = "L" + std::to_string(i / 16) + ":";
+        line += "\t";
+        switch (rng() % 8) {
+            case 0: line += "add    " + reg() + ", " + reg() + ", " + reg(); break;
+            case 1: line += "sub    " + reg() + ", " + reg() + ", " + reg(); break;
+            case 2: line += "lw     " + reg() + ", 12(" + reg() + ")"; break;
+            case 3: line += "sw     " + reg() + ", 4(" + reg() + ")"; break;
+            case 4: line += "addi   " + reg() + ", " + reg() + ", -4"; break;
+            case 5: line += "beq    " + reg() + ", " + reg() + ", L" + std::to_string(i / 16); break;
+            case 6: line += "j      L" + std::to_string(i / 16); break;
+            default: line += "nop"; break;
+        }
+        if (i % 5 == 0) line += "    # comment " + std::to_string(i);
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+std::vector<std::string> readLines(const std::string &path) {
+    std::ifstream fileReader(path);
+    std::vector<std::string> lines;
+    std::string currentLine;
+    while (getline(fileReader, currentLine)) lines.push_back(currentLine);
+    return lines;
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Runs split on all lines until at least min_lines lines were
+ * processed and returns the throughput in lines per second.
+ */
+double linesPerSecond(const std::vector<std::string> &lines,
+                      size_t min_lines,
+                      const std::function<size_t(const std::string &)> &split) {
+    size_t processed = 0;
+    size_t checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    while (processed < min_lines) {
+        for (const auto &line: lines) checksum += split(line);
+        processed += lines.size();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (checksum == 1) std::cout << "";  // keep the result alive
+    return processed / elapsed.count();
+}
+
+void report(const std::string &name, const std::vector<std::string> &lines, size_t min_lines) {
+    if (lines.empty()) return;
+    const double regex_rate = linesPerSecond(lines, min_lines, regexSplit);
+    const double lexer_rate = linesPerSecond(lines, min_lines, lexerSplit);
+    std::printf("%-24s %14.0f %14.0f %9.1fx\n", name.c_str(), regex_rate, lexer_rate, lexer_rate / regex_rate);
+}
+
+int main(int argc, char *argv[]) {
+    // call like "./bench-lexer [synthetic_line_count]"
+    const size_t synthetic_lines = argc > 1 ? std::stoul(argv[1]) : 200000;
+
+    std::printf("%-24s %14s %14s %10s\n", "input", "regex lines/s", "lexer lines/s", "speedup");
+    for (const char *name: {"program1.txt", "program2.txt", "program3.txt", "program4.txt"}) {
+        report(name, readLines(std::string(MIPS_EXAMPLES_DIR) + "/" + name), 20000);
+    }
+    report("synthetic (" + std::to_string(synthetic_lines) + ")", syntheticProgram(synthetic_lines), synthetic_lines);
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "output.hpp"
+
+// what outputPrinting needs to list one instruction
+struct ListedInstruction {
+    int address;
+    uint32_t binary_instruction;
+    std::string label;
+    std::vector<std::string> result;
+    std::string comment;
+};
+
+/**
+ * @brief Lists an instruction with iostream formatting, the way
+ * outputPrinting did before OutputBuffer. Kept here as the baseline.
+ */
+void streamListing(std::ofstream &outputListing, const ListedInstruction &line) {
+    std::ios hex_format(nullptr);
+    outputListing << "0x";
+    outputListing << std::hex << std::setw(8) << std::setfill('0');
+    hex_format.copyfmt(outputListing);
+    outputListing << line.address;
+    outputListing << "    0x";
+    outputListing.copyfmt(hex_format);
+    outputListing << line.binary_instruction;
+    if (line.label.empty()) {
+        outputListing << "                  ";
+    } else {
+        outputListing << "    ";
+        outputListing << std::left << std::setw(10) << std::setfill(' ') << line.label << std::right;
+        outputListing << "    ";
+    }
+    for (const auto &s: line.result) {
+        outputListing << s << " ";
+    }
+    if (!line.comment.empty()) {
+        outputListing << "    ";
+        outputListing << line.comment;
+    }
+    outputListing << "\n";
+}
+
+void bufferListing(OutputBuffer &outputListing, const ListedInstruction &line) {
+    outputListing.write("0x");
+    outputListing.hex8(line.address);
+    outputListing.write("    0x");
+    outputListing.hex8(line.binary_instruction);
+    if (line.label.empty()) {
+        outputListing.fill(' ', 18);
+    } else {
+        outputListing.fill(' ', 4);
+        outputListing.padded(line.label, 10);
+        outputListing.fill(' ', 4);
+    }
+    for (const auto &s: line.result) {
+        outputListing << s << " ";
+    }
+    if (!line.comment.empty()) {
+        outputListing.fill(' ', 4);
+        outputListing.write(line.comment);
+    }
+    outputListing.put('\n');
+}
+
+// --------------------------------------------------------
+
+std::vector<ListedInstruction> syntheticListing(size_t line_count) {
+    std::mt19937 rng(42);
+    std::vector<ListedInstruction> lines;
+    lines.reserve(line_count);
+    for (size_t i = 0; i < line_count; ++i) {
+        ListedInstruction line;
+        line.address = static_cast<int>(4 * i);
+        line.binary_instruction = rng();
+        if (i % 16 == 0) line.label = "L" + std::to_string(i / 16) + ":";
+        line.result = {"add", "$t1", "$t2", "$s0"};
+        if (i % 5 == 0) line.comment = "# comment " + std::to_string(i);
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+/**
+ * @brief Lists all lines repeat times into /dev/null.
+ *
+ * @return double seconds it took
+ */
+template <typename List>
+double listingSeconds(const std::vector<ListedInstruction> &lines, size_t repeat, List list) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < repeat; ++r) {
+        for (const auto &line: lines) list(line);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+    // call like "./bench-listing [line_count]"
+    const size_t line_count = argc > 1 ? std::stoul(argv[1]) : 200000;
+    const size_t repeat = 5;
+    const auto lines = syntheticListing(line_count);
+
+    // bytes of one listing, the same for both
+    size_t bytes = 0;
+    for (const auto &line: lines) {
+        bytes += 28 + (line.label.empty() ? 0 : std::max<size_t>(line.label.size(), 10) - 10) + 1;
+        for (const auto &s: line.result) bytes += s.size() + 1;
+        if (!line.comment.empty()) bytes += 4 + line.comment.size();
+    }
+
+    std::ofstream stream("/dev/null");
+    const double stream_seconds = listingSeconds(lines, repeat, [&](const ListedInstruction &line) {
+        streamListing(stream, line);
+    });
+    stream.close();
+
+    OutputBuffer buffer;
+    buffer.open("/dev/null");
+    const double buffer_seconds = listingSeconds(lines, repeat, [&](const ListedInstruction &line) {
+        bufferListing(buffer, line);
+    });
+    buffer.close();
+
+    const double total_lines = static_cast<double>(line_count * repeat);
+    const double total_mb = bytes * repeat / 1e6;
+    std::printf("%-16s %14s %10s %9s\n", "formatter", "lines/s", "MB/s", "speedup");
+    std::printf("%-16s %14.0f %10.1f %9.1fx\n", "std::ofstream", total_lines / stream_seconds, total_mb / stream_seconds, 1.0);
+    std::printf("%-16s %14.0f %10.1f %9.1fx\n", "OutputBuffer", total_lines / buffer_seconds, total_mb / buffer_seconds,
+                stream_seconds / buffer_seconds);
+    return 0;
+}
@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "assembler.hpp"
+#include "lexer.hpp"
+#include "output.hpp"
+#include "passes.hpp"
+#include "source.hpp"
+#include "synthetic.hpp"
+
+// a line of the program split for binInstruction and outputPrinting
+struct PreparedLine {
+    Instruction instruction;
+    std::string_view comment;
+    std::string_view label;
+    bool labelSingle = false;
+    size_t bytes = 0;  // length of the source line
+};
+
+// timing of one step of the assembler
+struct PhaseResult {
+    std::string name;
+    std::string unit;   // what items counts, e.g. "lines"
+    size_t items = 0;   // processed per run
+    size_t bytes = 0;   // read or written per run
+    double seconds = 0; // fastest run
+};
+
+/**
+ * @brief Runs run repeat times and returns the fastest time, which is the
+ * least disturbed by whatever else runs on the machine.
+ */
+template <typename Run>
+double bestSeconds(size_t repeat, Run run) {
+    double best = 0;
+    for (size_t r = 0; r < repeat; ++r) {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (r == 0 || elapsed.count() < best) best = elapsed.count();
+    }
+    return best;
+}
+
+/**
+ * @brief Splits every line the way secondPass does, with the labels resolved.
+ */
+std::vector<PreparedLine> prepareLines(std::string_view source, const SymbolTable &symbols) {
+    std::vector<PreparedLine> lines;
+    LineReader fileReader(source);
+    std::string_view currentLine;
+    int instruction_count = 0;
+    while (fileReader.next(currentLine)) {
+        const LineTokens tokens = lexLine(currentLine);
+        PreparedLine line;
+        line.comment = tokens.comment;
+        line.label = tokens.label;
+        line.labelSingle = tokens.label_single;
+        line.bytes = currentLine.size() + 1;
+        parseInstruction(tokens, line.instruction);
+        if (!line.instruction.jump_label.empty()) {
+            resolveLabel(line.instruction, *symbols.find(line.instruction.jump_label, line.instruction.jump_hash), instruction_count);
+        }
+        if (line.instruction.kind == INSTRUCTION_CODE && !line.labelSingle) instruction_count += 4;
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+// --------------------------------------------------------
+
+void printUsage(const char *program) {
+    std::fprintf(stderr,
+                 "usage: %s [--lines=N] [--r=W] [--i=W] [--j=W] [--labels=F] [--comments=F]\n"
+                 "       [--forward=F] [--seed=N] [--repeat=N] [--json=FILE]\n",
+                 program);
+}
+
+/**
+ * @brief Reads "--name=value" options into the mix.
+ *
+ * @return bool false if an option is unknown or its value isn't a number
+ */
+bool parseOptions(int argc, char *argv[], ProgramMix &mix, size_t &repeat, std::string &json_path) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const size_t equals = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || equals == std::string::npos) return false;
+        const std::string name = arg.substr(2, equals - 2);
+        const std::string value = arg.substr(equals + 1);
+        try {
+            if (name == "lines") mix.lines = std::stoul(value);
+            else if (name == "r") mix.r_type = std::stod(value);
+            else if (name == "i") mix.i_type = std::stod(value);
+            else if (name == "j") mix.j_type = std::stod(value);
+            else if (name == "labels") mix.labels = std::stod(value);
+            else if (name == "comments") mix.comments = std::stod(value);
+            else if (name == "forward") mix.forward = std::stod(value);
+            else if (name == "seed") mix.seed = static_cast<uint32_t>(std::stoul(value));
+            else if (name == "repeat") repeat = std::max<size_t>(std::stoul(value), 1);
+            else if (name == "json") json_path = value;
+            else return false;
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+    return mix.r_type + mix.i_type + mix.j_type > 0;
+}
+
+/**
+ * @brief Writes the results as JSON, one object per run of the benchmark, so
+ * results of different versions can be compared by scripts.
+ */
+bool writeJson(const std::string &path,
+               const ProgramMix &mix,
+               size_t source_bytes,
+               const std::vector<PhaseResult> &phases) {
+    std::FILE *json = std::fopen(path.c_str(), "w");
+    if (json == nullptr) return false;
+    std::fprintf(json, "{\n  \"benchmark\": \"mips-bench\",\n  \"version\": \"%s\",\n", MIPS_VERSION);
+    std::fprintf(json,
+                 "  \"program\": {\"lines\": %zu, \"bytes\": %zu, \"r\": %g, \"i\": %g, \"j\": %g, "
+                 "\"labels\": %g, \"comments\": %g, \"forward\": %g, \"seed\": %u},\n",
+                 mix.lines, source_bytes, mix.r_type, mix.i_type, mix.j_type, mix.labels, mix.comments, mix.forward,
+                 static_cast<unsigned>(mix.seed));
+    std::fprintf(json, "  \"phases\": [\n");
+    for (size_t i = 0; i < phases.size(); ++i) {
+        const PhaseResult &phase = phases[i];
+        std::fprintf(json,
+                     "    {\"name\": \"%s\", \"unit\": \"%s\", \"items\": %zu, \"bytes\": %zu, \"seconds\": %.9f, "
+                     "\"items_per_second\": %.1f, \"mb_per_second\": %.3f}%s\n",
+                     phase.name.c_str(), phase.unit.c_str(), phase.items, phase.bytes, phase.seconds,
+                     phase.items / phase.seconds, phase.bytes / phase.seconds / 1e6, i + 1 < phases.size() ? "," : "");
+    }
+    std::fprintf(json, "  ]\n}\n");
+    return std::fclose(json) == 0;
+}
+
+// --------------------------------------------------------
+
+int main(int argc, char *argv[]) {
+    // call like "./mips-bench --lines=500000 --labels=0.2 --json=results.json"
+    ProgramMix mix;
+    size_t repeat = 5;
+    std::string json_path;
+    if (!parseOptions(argc, argv, mix, repeat, json_path)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    const std::string source = syntheticSource(mix);
+    SymbolTable symbols;
+    std::vector<Diagnostic> warnings;
+    firstPass(source, symbols, warnings);
+    std::vector<PreparedLine> lines = prepareLines(source, symbols);
+
+    std::vector<const Instruction *> instructions;
+    std::vector<std::string_view> registers;
+    size_t instruction_bytes = 0;
+    size_t register_bytes = 0;
+    for (const auto &line: lines) {
+        if (line.instruction.kind != INSTRUCTION_CODE) continue;
+        instructions.push_back(&line.instruction);
+        instruction_bytes += line.bytes;
+        for (size_t i = 1; i < line.instruction.part_count; ++i) {
+            const std::string_view part = line.instruction.parts[i];
+            if (part.empty() || part[0] != '$') continue;
+            registers.push_back(part);
+            register_bytes += part.size();
+        }
+    }
+    std::vector<uint32_t> words;
+    std::string errors;
+    OutputBuffer errout;
+    errout.openString(errors);
+    for (const auto *instruction: instructions) words.push_back(binInstruction(*instruction, errout));
+
+    // the listing is only known after writing it once
+    std::string listing_text;
+    {
+        OutputBuffer listing;
+        listing.openString(listing_text);
+        std::vector<uint32_t> discarded;
+        InstructionOutput output(discarded);
+        int instruction_count = 0;
+        for (auto &line: lines) {
+            outputPrinting(listing, output, line.instruction, line.comment, line.label, instruction_count, line.labelSingle);
+        }
+        listing.close();
+    }
+
+    OutputBuffer null_output;
+    null_output.open("/dev/null");
+    std::vector<PhaseResult> phases;
+    uint32_t checksum = 0;
+
+    phases.push_back({"assemble", "lines", lines.size(), source.size(), bestSeconds(repeat, [&] {
+        InstructionOutput output(null_output, OUTPUT_FORMAT_HEX, true);
+        AssemblyOptions options;
+        checksum += assemble(source, options, null_output, output).ok;
+    })});
+    phases.push_back({"assemble (no listing)", "lines", lines.size(), source.size(), bestSeconds(repeat, [&] {
+        OutputBuffer errout;
+        InstructionOutput output(null_output, OUTPUT_FORMAT_HEX, true);
+        AssemblyOptions options;
+        options.listing = false;
+        checksum += assemble(source, options, errout, output).ok;
+    })});
+    phases.push_back({"firstPass", "lines", lines.size(), source.size(), bestSeconds(repeat, [&] {
+        SymbolTable labels;
+        std::vector<Diagnostic> label_warnings;
+        firstPass(source, labels, label_warnings);
+        checksum += labels.size();
+    })});
+    phases.push_back({"secondPass", "lines", lines.size(), source.size(), bestSeconds(repeat, [&] {
+        InstructionOutput output(null_output, OUTPUT_FORMAT_HEX, true);
+        secondPass(source, null_output, output, symbols, true);
+    })});
+    phases.push_back({"secondPass (no listing)", "lines", lines.size(), source.size(), bestSeconds(repeat, [&] {
+        OutputBuffer errout;
+        InstructionOutput output(null_output, OUTPUT_FORMAT_HEX, true);
+        secondPass(source, errout, output, symbols, false);
+    })});
+    Arena arena;
+    Program program;
+    phases.push_back({"buildProgram", "lines", lines.size(), source.size(), bestSeconds(repeat, [&] {
+        arena.reset();
+        checksum += buildProgram(program, arena, source, 0, true);
+    })});
+    resolveProgramLabels(program, symbols);
+    phases.push_back({"encodeProgram", "instructions", instructions.size(), instruction_bytes, bestSeconds(repeat, [&] {
+        checksum += encodeProgram(program);
+    })});
+    phases.push_back({"listProgram", "lines", lines.size(), listing_text.size(), bestSeconds(repeat, [&] {
+        listProgram(program, program.line_count, null_output);
+        null_output.flush();
+    })});
+    phases.push_back({"binInstruction", "instructions", instructions.size(), instruction_bytes, bestSeconds(repeat, [&] {
+        for (const auto *instruction: instructions) checksum += binInstruction(*instruction, errout);
+    })});
+    phases.push_back({"regCode", "registers", registers.size(), register_bytes, bestSeconds(repeat, [&] {
+        for (const auto name: registers) checksum += regCode(name, decodeRegister(name), errout);
+    })});
+    phases.push_back({"outputPrinting", "lines", lines.size(), listing_text.size(), bestSeconds(repeat, [&] {
+        InstructionOutput output(null_output, OUTPUT_FORMAT_HEX, true);
+        int instruction_count = 0;
+        for (auto &line: lines) {
+            outputPrinting(null_output, output, line.instruction, line.comment, line.label, instruction_count, line.labelSingle);
+        }
+    })});
+    phases.push_back({"hex writer", "words", words.size(), words.size() * 11, bestSeconds(repeat, [&] {
+        InstructionOutput output(null_output, OUTPUT_FORMAT_HEX, true);
+        for (uint32_t word: words) output.add(word);
+        output.finish();
+        null_output.flush();
+    })});
+    phases.push_back({"bin writer", "words", words.size(), words.size() * 4, bestSeconds(repeat, [&] {
+        InstructionOutput output(null_output, OUTPUT_FORMAT_BIN, true);
+        for (uint32_t word: words) output.add(word);
+        output.finish();
+        null_output.flush();
+    })});
+    size_t symbol_bytes = 9;  // "\nSymbols\n"
+    for (const auto &lbl: symbols.symbols()) symbol_bytes += std::max<size_t>(lbl.name.size(), 13) + 12;
+    phases.push_back({"symbols", "labels", symbols.size(), symbol_bytes, bestSeconds(repeat, [&] {
+        symbolsOutputPrinting(null_output, symbols);
+        null_output.flush();
+    })});
+    null_output.close();
+    if (checksum == 1) std::printf(" ");  // keep the results alive
+
+    std::printf("program: %zu lines, %.1f MB, %zu instructions, %zu labels\n", lines.size(), source.size() / 1e6,
+                instructions.size(), symbols.size());
+    std::printf("%-24s %-13s %14s %10s %10s\n", "phase", "unit", "units/s", "MB/s", "ms");
+    for (const auto &phase: phases) {
+        std::printf("%-24s %-13s %14.0f %10.1f %10.3f\n", phase.name.c_str(), phase.unit.c_str(),
+                    phase.items / phase.seconds, phase.bytes / phase.seconds / 1e6, phase.seconds * 1e3);
+    }
+    if (!json_path.empty() && !writeJson(json_path, mix, source.size(), phases)) {
+        std::fprintf(stderr, "Error: %s could not be written\n", json_path.c_str());
+        return 1;
+    }
+    return 0;
+}
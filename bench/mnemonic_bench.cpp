@@ -0,0 +1,77 @@
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "definitions.hpp"
+
+// INSTR_CODES as it was before the perfect hash, the baseline
+const std::map<std::string, InstructionCodes> INSTR_MAP = {
+    {"add", {0x00, INSTR_TYPE_R, 0x20}},
+    {"sub", {0x00, INSTR_TYPE_R, 0x22}},
+    {"and", {0x00, INSTR_TYPE_R, 0x24}},
+    {"or", {0x00, INSTR_TYPE_R, 0x25}},
+    {"nor", {0x00, INSTR_TYPE_R, 0x27}},
+    {"slt", {0x00, INSTR_TYPE_R, 0x2A}},
+    {"lw", {0x23, INSTR_TYPE_I, 0x00}},
+    {"sw", {0x2B, INSTR_TYPE_I, 0x00}},
+    {"beq", {0x04, INSTR_TYPE_I, 0x00}},
+    {"addi", {0x08, INSTR_TYPE_I, 0x00}},
+    {"sll", {0x00, INSTR_TYPE_R_SHIFT, 0x00}},
+    {"j", {0x02, INSTR_TYPE_J, 0x00}},
+    {"jr", {0x00, INSTR_TYPE_R, 0x08}},
+    {"nop", {0x00, INSTR_TYPE_NULL, 0x00}}};
+
+/**
+ * @brief Times lookup over all mnemonics until at least min_lookups were done.
+ *
+ * @return double lookups per second
+ */
+template <typename Lookup>
+double lookupsPerSecond(size_t count, size_t min_lookups, Lookup lookup) {
+    uint32_t checksum = 0;
+    size_t done = 0;
+    const auto start = std::chrono::steady_clock::now();
+    while (done < min_lookups) {
+        for (size_t i = 0; i < count; ++i) checksum += lookup(i);
+        done += count;
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (checksum == 1) std::printf(" ");  // keep the result alive
+    return done / elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+    // call like "./bench-mnemonic [lookup_count]"
+    const size_t min_lookups = argc > 1 ? std::stoul(argv[1]) : 20000000;
+
+    // mostly valid mnemonics, some unknown ones, in random order
+    static const char *const names[] = {"add", "sub",  "and", "or",  "nor", "slt", "lw",   "sw",
+                                        "beq", "addi", "sll", "j",   "jr",  "nop", "bne",  "mul"};
+    std::mt19937 rng(42);
+    std::vector<std::string> strings;
+    for (size_t i = 0; i < 4096; ++i) strings.push_back(names[rng() % 16]);
+    const std::vector<std::string_view> views(strings.begin(), strings.end());
+
+    const double map_rate = lookupsPerSecond(strings.size(), min_lookups, [&](size_t i) {
+        const auto result = INSTR_MAP.find(strings[i]);
+        return result == INSTR_MAP.end() ? 0u : result->second.op_code;
+    });
+    const double map_view_rate = lookupsPerSecond(views.size(), min_lookups, [&](size_t i) {
+        const auto result = INSTR_MAP.find(std::string(views[i]));
+        return result == INSTR_MAP.end() ? 0u : result->second.op_code;
+    });
+    const double hash_rate = lookupsPerSecond(views.size(), min_lookups, [&](size_t i) {
+        const InstructionEntry *result = INSTR_TABLE.find(views[i]);
+        return result == nullptr ? 0u : result->codes.op_code;
+    });
+
+    std::printf("%-34s %14s %9s\n", "lookup", "lookups/s", "speedup");
+    std::printf("%-34s %14.0f %9.1fx\n", "std::map, std::string key", map_rate, 1.0);
+    std::printf("%-34s %14.0f %9.1fx\n", "std::map, key built from view", map_view_rate, map_view_rate / map_rate);
+    std::printf("%-34s %14.0f %9.1fx\n", "INSTR_TABLE (perfect hash)", hash_rate, hash_rate / map_rate);
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "definitions.hpp"
+
+// REGISTER_ABRV as it was before decodeRegister, the baseline
+const std::map<std::string, uint32_t> REGISTER_MAP = {
+    {"$zero", 0}, {"$at", 1},  {"$v0", 2},  {"$v1", 3},  {"$a0", 4},
+    {"$a1", 5},   {"$a2", 6},  {"$a3", 7},  {"$t0", 8},  {"$t1", 9},
+    {"$t2", 10},  {"$t3", 11}, {"$t4", 12}, {"$t5", 13}, {"$t6", 14},
+    {"$t7", 15},  {"$s0", 16}, {"$s1", 17}, {"$s2", 18}, {"$s3", 19},
+    {"$s4", 20},  {"$s5", 21}, {"$s6", 22}, {"$s7", 23}, {"$t8", 24},
+    {"$t9", 25},  {"$k0", 26}, {"$k1", 27}, {"$gp", 28}, {"$sp", 29},
+    {"$fp", 30},  {"$ra", 31}};
+
+/**
+ * @brief regCode as it was before decodeRegister, without the error output.
+ */
+uint32_t regexRegCode(const std::string &s) {
+    if (!std::regex_match(s, std::regex(R"([$](zero|[0-9]{2}|[a-z]\d|[a-z]{2}))"))) return 0;
+    if (s[1] >= 48 && s[1] <= 57) return stoi(s.substr(1, s.length() - 1));
+    const auto result = REGISTER_MAP.find(s);
+    return result == REGISTER_MAP.end() ? 0 : result->second;
+}
+
+/**
+ * @brief Times decode over all names until at least min_decodes were done.
+ *
+ * @return double decoded registers per second
+ */
+template <typename Decode>
+double decodesPerSecond(const std::vector<std::string> &names, size_t min_decodes, Decode decode) {
+    uint32_t checksum = 0;
+    size_t done = 0;
+    const auto start = std::chrono::steady_clock::now();
+    while (done < min_decodes) {
+        for (const auto &name: names) checksum += decode(name);
+        done += names.size();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (checksum == 1) std::printf(" ");  // keep the result alive
+    return done / elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+    // call like "./bench-register [decode_count]"
+    const size_t min_decodes = argc > 1 ? std::stoul(argv[1]) : 50000;
+
+    // abbreviations and numeric names in random order
+    std::mt19937 rng(42);
+    std::vector<std::string> names;
+    for (size_t i = 0; i < 4096; ++i) {
+        if (i % 4 == 0) {
+            const uint32_t number = rng() % 32;
+            names.push_back("$" + std::to_string(number / 10) + std::to_string(number % 10));
+        } else {
+            names.push_back(std::string(REGISTER_ABRV[rng() % 32].name));
+        }
+    }
+
+    const double regex_rate = decodesPerSecond(names, min_decodes, regexRegCode);
+    // the table lookup needs many more iterations for a stable number
+    const double table_rate = decodesPerSecond(names, min_decodes * 100, [](const std::string &name) {
+        return decodeRegister(name).number;
+    });
+
+    std::printf("%-30s %14s %9s\n", "decoder", "registers/s", "speedup");
+    std::printf("%-30s %14.0f %9.1fx\n", "regex + std::map (regCode)", regex_rate, 1.0);
+    std::printf("%-30s %14.0f %9.1fx\n", "decodeRegister", table_rate, table_rate / regex_rate);
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "synthetic.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+const char *const REGISTERS[] = {"$zero", "$at", "$v0", "$a0", "$t0", "$t1", "$t2", "$t7",
+                                 "$s0",   "$s1", "$s7", "$sp", "$ra", "$08",  "$17", "$31"};
+const char *const R_TYPE[] = {"add", "sub", "and", "or", "nor", "slt"};
+
+// number of labels in front of or behind a jump it picks its target from
+constexpr size_t TARGET_WINDOW = 8;
+
+/**
+ * @brief Picks the label a beq or j on line jumps to.
+ *
+ * @param label_lines lines that define a label, ascending
+ * @param forward true to jump to a label after the line, if there is one
+ * @return long line of the label, -1 if there is no label at all
+ */
+long jumpTarget(const std::vector<size_t> &label_lines, size_t line, bool forward, std::mt19937 &rng) {
+    if (label_lines.empty()) return -1;
+    const size_t next = std::upper_bound(label_lines.begin(), label_lines.end(), line) - label_lines.begin();
+    const size_t behind = next == 0 ? 0 : std::min(next, TARGET_WINDOW);
+    const size_t ahead = std::min(label_lines.size() - next, TARGET_WINDOW);
+    if (ahead != 0 && (forward || behind == 0)) {
+        return static_cast<long>(label_lines[next + rng() % ahead]);
+    }
+    return static_cast<long>(label_lines[next - 1 - rng() % behind]);
+}
+
+}  // namespace
+
+// --------------------------------------------------------
+
+std::string syntheticSource(const ProgramMix &mix) {
+    std::mt19937 rng(mix.seed);
+    std::uniform_real_distribution<double> share(0.0, 1.0);
+    auto reg = [&]() { return std::string(REGISTERS[rng() % 16]); };
+
+    std::vector<size_t> label_lines;
+    for (size_t i = 0; i < mix.lines; ++i) {
+        if (share(rng) < mix.labels) label_lines.push_back(i);
+    }
+    std::vector<bool> has_label(mix.lines, false);
+    for (size_t line: label_lines) has_label[line] = true;
+
+    const double type_total = mix.r_type + mix.i_type + mix.j_type;
+    std::string source;
+    source.reserve(mix.lines * 32);
+    for (size_t i = 0; i < mix.lines; ++i) {
+        if (has_label[i]) source += "L" + std::to_string(i) + ":";
+        source += "\t";
+
+        const double type = share(rng) * type_total;
+        const bool forward = share(rng) < mix.forward;
+        if (type < mix.r_type) {
+            switch (rng() % 8) {
+                case 6: source += "sll    " + reg() + ", " + reg() + ", " + std::to_string(rng() % 32); break;
+                case 7: source += "jr     " + reg(); break;
+                default: source += std::string(R_TYPE[rng() % 6]) + "    " + reg() + ", " + reg() + ", " + reg(); break;
+            }
+        } else if (type < mix.r_type + mix.i_type) {
+            switch (rng() % 4) {
+                case 0: source += "lw     " + reg() + ", " + std::to_string(rng() % 64 * 4) + "(" + reg() + ")"; break;
+                case 1: source += "sw     " + reg() + ", " + std::to_string(rng() % 64 * 4) + "(" + reg() + ")"; break;
+                case 2: source += "addi   " + reg() + ", " + reg() + ", " + std::to_string(rng() % 1000); break;
+                default: {
+                    const long target = jumpTarget(label_lines, i, forward, rng);
+                    source += "beq    " + reg() + ", " + reg() + ", ";
+                    source += target < 0 ? std::to_string(rng() % 16) : "L" + std::to_string(target);
+                    break;
+                }
+            }
+        } else {
+            const long target = jumpTarget(label_lines, i, forward, rng);
+            source += "j      ";
+            source += target < 0 ? std::to_string(rng() % 1024) : "L" + std::to_string(target);
+        }
+
+        if (share(rng) < mix.comments) source += "    # comment " + std::to_string(i);
+        source += "\n";
+    }
+    return source;
+}
@@ -0,0 +1,31 @@
+#ifndef MIPS_BENCH_SYNTHETIC_H
+#define MIPS_BENCH_SYNTHETIC_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Shape of a generated program. The type shares are weights, they
+ * don't need to add up to 1.
+ */
+struct ProgramMix {
+    size_t lines = 200000;
+    double r_type = 0.5;    // add, sub, and, or, nor, slt, sll, jr
+    double i_type = 0.4;    // lw, sw, addi, beq
+    double j_type = 0.1;    // j
+    double labels = 0.1;    // share of the lines that define a label
+    double comments = 0.2;  // share of the lines that end with a comment
+    double forward = 0.5;   // share of the beq and j that jump forward
+    uint32_t seed = 42;
+};
+
+/**
+ * @brief Generates a valid program: every beq and j names a label that
+ * exists and every beq offset fits into its 16 bits.
+ *
+ * @param mix size and instruction mix of the program
+ * @return std::string the source, one instruction per line
+ */
+std::string syntheticSource(const ProgramMix &mix);
+
+#endif
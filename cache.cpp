@@ -0,0 +1,289 @@
+#include "cache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+#include "source.hpp"
+
+namespace {
+
+// changes whenever the layout of an entry changes
+constexpr int CACHE_FORMAT = 1;
+
+constexpr uint64_t MURMUR_MULTIPLIER = 0xc6a4a7935bd1e995ull;
+
+std::string hex16(uint64_t value) {
+    std::string digits(16, '0');
+    for (int i = 15; i >= 0; --i, value >>= 4) {
+        digits[i] = "0123456789abcdef"[value & 0xF];
+    }
+    return digits;
+}
+
+// --------------------------------------------------------
+
+bool writeAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t count = ::write(fd, data.data(), data.size());
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) return false;
+        data.remove_prefix(count);
+    }
+    return true;
+}
+
+bool writeFile(const std::string &path, std::string_view data) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) return false;
+    const bool written = writeAll(fd, data);
+    return ::close(fd) == 0 && written;
+}
+
+/**
+ * @brief Copies the rest of in to out. copy_file_range keeps the data in the
+ * kernel; where it isn't supported the data goes through a buffer.
+ */
+bool copyData(int in, int out) {
+#ifdef __linux__
+    while (true) {
+        const ssize_t count = ::copy_file_range(in, nullptr, out, nullptr, 1 << 30, 0);
+        if (count == 0) return true;
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) break;
+    }
+#endif
+    char buffer[1 << 16];
+    while (true) {
+        const ssize_t count = ::read(in, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return count == 0;
+        if (!writeAll(out, {buffer, static_cast<size_t>(count)})) return false;
+    }
+}
+
+/**
+ * @brief Replaces to with a copy of from. File systems that can share blocks
+ * between files (btrfs, xfs) get a reflink instead of a copy.
+ */
+bool copyFile(const std::string &from, const std::string &to) {
+    const int in = ::open(from.c_str(), O_RDONLY);
+    if (in < 0) return false;
+    const int out = ::open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (out < 0) {
+        ::close(in);
+        return false;
+    }
+    bool copied = false;
+#ifdef FICLONE
+    copied = ::ioctl(out, FICLONE, in) == 0;
+#endif
+    if (!copied) copied = copyData(in, out);
+    ::close(in);
+    return ::close(out) == 0 && copied;
+}
+
+// --------------------------------------------------------
+
+void appendDiagnostics(std::string &text, const char *kind, const std::vector<Diagnostic> &diagnostics) {
+    for (const auto &diagnostic: diagnostics) {
+        text += kind;
+        text += ' ' + std::to_string(diagnostic.line) + ' ' + std::to_string(diagnostic.message.size()) + '\n';
+        text += diagnostic.message;
+    }
+}
+
+/**
+ * @brief The result file of an entry: the sizes of the outputs, which tell a
+ * truncated entry from a complete one, then diagnostics and symbols. Messages
+ * are prefixed with their size since they contain line breaks.
+ */
+std::string resultText(const AssemblyResult &result, uintmax_t listing_size, uintmax_t instructions_size) {
+    std::string text = "mips-assembler cache " + std::to_string(CACHE_FORMAT) + '\n';
+    text += "ok " + std::to_string(result.ok) + '\n';
+    text += "listing " + std::to_string(listing_size) + '\n';
+    text += "instructions " + std::to_string(instructions_size) + '\n';
+    appendDiagnostics(text, "warning", result.warnings);
+    appendDiagnostics(text, "error", result.diagnostics);
+    for (const auto &symbol: result.symbols) {
+        text += "symbol " + std::to_string(symbol.address) + ' ' + symbol.name + '\n';
+    }
+    return text;
+}
+
+/**
+ * @brief Reads the fields of a result file one by one.
+ */
+class ResultReader {
+public:
+    explicit ResultReader(std::string_view text) : rest_(text) {}
+
+    bool done() const { return rest_.empty(); }
+
+    // the next word, up to a ' ' or '\n'
+    std::string_view word() {
+        const size_t end = std::min(rest_.find_first_of(" \n"), rest_.size());
+        const std::string_view word = rest_.substr(0, end);
+        rest_.remove_prefix(std::min(end + 1, rest_.size()));
+        return word;
+    }
+
+    template <typename T>
+    bool number(T &value) {
+        const std::string_view digits = word();
+        const auto parsed = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+        return !digits.empty() && parsed.ec == std::errc() && parsed.ptr == digits.data() + digits.size();
+    }
+
+    bool bytes(size_t count, std::string &value) {
+        if (count > rest_.size()) return false;
+        value.assign(rest_.substr(0, count));
+        rest_.remove_prefix(count);
+        return true;
+    }
+
+private:
+    std::string_view rest_;
+};
+
+bool parseResult(std::string_view text,
+                 AssemblyResult &result,
+                 uintmax_t &listing_size,
+                 uintmax_t &instructions_size) {
+    ResultReader reader(text);
+    int format = 0;
+    int ok = 0;
+    if (reader.word() != "mips-assembler" || reader.word() != "cache" || !reader.number(format) ||
+        format != CACHE_FORMAT || reader.word() != "ok" || !reader.number(ok) ||
+        reader.word() != "listing" || !reader.number(listing_size) ||
+        reader.word() != "instructions" || !reader.number(instructions_size)) {
+        return false;
+    }
+    result.ok = ok != 0;
+    while (!reader.done()) {
+        const std::string_view kind = reader.word();
+        if (kind == "warning" || kind == "error") {
+            Diagnostic diagnostic;
+            size_t size = 0;
+            if (!reader.number(diagnostic.line) || !reader.number(size) || !reader.bytes(size, diagnostic.message)) {
+                return false;
+            }
+            (kind == "warning" ? result.warnings : result.diagnostics).push_back(std::move(diagnostic));
+        } else if (kind == "symbol") {
+            Symbol symbol;
+            if (!reader.number(symbol.address)) return false;
+            symbol.name = reader.word();
+            result.symbols.push_back(std::move(symbol));
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Outputs on stdout can't be copied, programs written there are neither
+ * looked up nor stored.
+ */
+bool cacheable(const BatchJob &job) {
+    return job.listing != "-" && job.instructions != "-";
+}
+
+}  // namespace
+
+// --------------------------------------------------------
+
+uint64_t contentHash(std::string_view data, uint64_t seed) {
+    uint64_t hash = seed ^ (data.size() * MURMUR_MULTIPLIER);
+    size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data.data() + i, 8);
+        word *= MURMUR_MULTIPLIER;
+        word ^= word >> 47;
+        word *= MURMUR_MULTIPLIER;
+        hash ^= word;
+        hash *= MURMUR_MULTIPLIER;
+    }
+    if (i < data.size()) {
+        for (size_t shift = 0; i < data.size(); ++i, shift += 8) {
+            hash ^= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << shift;
+        }
+        hash *= MURMUR_MULTIPLIER;
+    }
+    hash ^= hash >> 47;
+    hash *= MURMUR_MULTIPLIER;
+    hash ^= hash >> 47;
+    return hash;
+}
+
+std::string cacheKey(std::string_view source, const BatchOptions &options) {
+    // the threads don't change the outputs, --jobs isn't part of the key
+    std::string settings = "mips-assembler " MIPS_VERSION " cache " + std::to_string(CACHE_FORMAT);
+    settings += options.assembly.one_pass ? " one-pass" : " two-pass";
+    settings += options.format == OUTPUT_FORMAT_BIN ? " bin" : " hex";
+    settings += options.big_endian ? " big" : " little";
+    const uint64_t seed = contentHash(settings, 0);
+    // two hashes with different seeds, 128 bits make collisions practically
+    // impossible
+    return hex16(contentHash(source, seed)) + hex16(contentHash(source, ~seed));
+}
+
+// --------------------------------------------------------
+
+bool loadCached(const std::string &cache_dir, const std::string &key, const BatchJob &job, AssemblyResult &result) {
+    if (!cacheable(job)) return false;
+    const std::string entry = cache_dir + "/" + key;
+    SourceFile resultReader;
+    if (!resultReader.open(entry + "/result")) return false;
+
+    AssemblyResult cached;
+    uintmax_t listing_size = 0;
+    uintmax_t instructions_size = 0;
+    if (!parseResult(resultReader.contents(), cached, listing_size, instructions_size)) return false;
+    std::error_code error;
+    if (std::filesystem::file_size(entry + "/listing", error) != listing_size || error ||
+        std::filesystem::file_size(entry + "/instructions", error) != instructions_size || error) {
+        return false;
+    }
+    if (!copyFile(entry + "/listing", job.listing) || !copyFile(entry + "/instructions", job.instructions)) {
+        return false;
+    }
+    result = std::move(cached);
+    return true;
+}
+
+void storeCached(const std::string &cache_dir, const std::string &key, const BatchJob &job, const AssemblyResult &result) {
+    if (!cacheable(job)) return;
+    static std::atomic<unsigned> next_entry{0};
+    std::error_code error;
+    std::filesystem::create_directories(cache_dir, error);
+    const std::string entry = cache_dir + "/" + key;
+    if (std::filesystem::exists(entry, error)) return;
+
+    // unique for every thread of every process that shares the cache
+    const std::string temporary = cache_dir + "/.tmp-" + key + "-" + std::to_string(::getpid()) + "-" +
+                                  std::to_string(next_entry++);
+    if (::mkdir(temporary.c_str(), 0777) != 0) return;
+    const uintmax_t listing_size = std::filesystem::file_size(job.listing, error);
+    const uintmax_t instructions_size = error ? 0 : std::filesystem::file_size(job.instructions, error);
+    const bool written = !error &&
+                         copyFile(job.listing, temporary + "/listing") &&
+                         copyFile(job.instructions, temporary + "/instructions") &&
+                         writeFile(temporary + "/result", resultText(result, listing_size, instructions_size));
+    // a process that stored the same entry first wins, both are the same
+    if (!written || ::rename(temporary.c_str(), entry.c_str()) != 0) {
+        std::filesystem::remove_all(temporary, error);
+    }
+}
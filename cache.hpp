@@ -0,0 +1,48 @@
+#ifndef MIPS_CACHE_H
+#define MIPS_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "assembler.hpp"
+#include "batch.hpp"
+
+/**
+ * @brief 64-bit hash of data (MurmurHash64A), eight bytes at a time.
+ */
+uint64_t contentHash(std::string_view data, uint64_t seed);
+
+/**
+ * @brief Name of the cache entry of a source: a hash of the source bytes, the
+ * assembler version and every option that changes the outputs.
+ */
+std::string cacheKey(std::string_view source, const BatchOptions &options);
+
+/**
+ * @brief Looks up a program in the cache. On a hit the cached listing and
+ * instructions are copied (or reflinked) to the outputs of job and result
+ * gets the symbols and diagnostics of the cached assembly.
+ *
+ * @param cache_dir directory of the cache
+ * @param key cacheKey of the source
+ * @param job the outputs to write
+ * @param result receives the cached result
+ * @return bool false if there is no complete entry for key
+ */
+bool loadCached(const std::string &cache_dir, const std::string &key, const BatchJob &job, AssemblyResult &result);
+
+/**
+ * @brief Adds the outputs of an assembled program to the cache. The entry is
+ * written into a directory of its own and renamed into place, so processes
+ * sharing the cache either see a complete entry or none. Errors are ignored,
+ * the program is just not cached.
+ *
+ * @param cache_dir directory of the cache, created if it doesn't exist
+ * @param key cacheKey of the source
+ * @param job the outputs of the program, already written and closed
+ * @param result result of the assembly
+ */
+void storeCached(const std::string &cache_dir, const std::string &key, const BatchJob &job, const AssemblyResult &result);
+
+#endif
@@ -1,8 +1,10 @@
 #ifndef MIPS_DEFINITIONS_H
 #define MIPS_DEFINITIONS_H
 
-#include <map>
-#include <string>
+#include <cstdint>
+#include <string_view>
+
+#include "perfect_hash.hpp"
 
 enum {
     INSTR_TYPE_R,
@@ -18,7 +20,13 @@ struct InstructionCodes {
     uint32_t function = 0x00;
 };
 
-const std::map<std::string, InstructionCodes> INSTR_CODES = {
+struct InstructionEntry {
+    std::string_view name;
+    InstructionCodes codes;
+};
+
+// supported instructions, new mnemonics only need a line here
+inline constexpr InstructionEntry INSTR_CODES[] = {
     {"add", {0x00, INSTR_TYPE_R, 0x20}},        // R, 0x20
     {"sub", {0x00, INSTR_TYPE_R, 0x22}},        // R, 0x22
     {"and", {0x00, INSTR_TYPE_R, 0x24}},        // R, 0x24
@@ -34,8 +42,17 @@ const std::map<std::string, InstructionCodes> INSTR_CODES = {
     {"jr", {0x00, INSTR_TYPE_R, 0x08}},         // R, 0x08
     {"nop", {0x00, INSTR_TYPE_NULL, 0x00}}};
 
+// lookup table for INSTR_CODES, built by the compiler
+inline constexpr PerfectHash INSTR_TABLE(INSTR_CODES);
+static_assert(INSTR_TABLE.valid(), "no perfect hash for INSTR_CODES, is a mnemonic listed twice?");
+
 // register abbreviations
-const std::map<std::string, uint32_t> REGISTER_ABRV = {
+struct RegisterEntry {
+    std::string_view name;
+    uint32_t number;
+};
+
+inline constexpr RegisterEntry REGISTER_ABRV[] = {
     {"$zero", 0}, {"$at", 1},  {"$v0", 2},  {"$v1", 3},  {"$a0", 4},
     {"$a1", 5},   {"$a2", 6},  {"$a3", 7},  {"$t0", 8},  {"$t1", 9},
     {"$t2", 10},  {"$t3", 11}, {"$t4", 12}, {"$t5", 13}, {"$t6", 14},
@@ -44,4 +61,75 @@ const std::map<std::string, uint32_t> REGISTER_ABRV = {
     {"$t9", 25},  {"$k0", 26}, {"$k1", 27}, {"$gp", 28}, {"$sp", 29},
     {"$fp", 30},  {"$ra", 31}};
 
+enum {
+    REGISTER_OK,
+    REGISTER_INVALID,       // not of the form $zero, $00..$99, $a0..$z9, $aa..$zz
+    REGISTER_OUT_OF_RANGE,  // numeric index above 31
+    REGISTER_UNSUPPORTED    // well-formed, but no such abbreviation
+};
+
+struct RegisterCode {
+    int status = REGISTER_OK;
+    uint32_t number = 0;
+};
+
+constexpr bool isLowerAlpha(char c) {
+    return c >= 'a' && c <= 'z';
+}
+
+constexpr bool isDecimal(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// slot of a two character abbreviation "$xy" with x in a..z, y in a..z or 0..9
+constexpr size_t abbreviationSlot(char first, char second) {
+    return (first - 'a') * 36 + (isDecimal(second) ? second - '0' : 10 + second - 'a');
+}
+
+// register number for every two character abbreviation, -1 if there is none
+inline constexpr struct AbbreviationTable {
+    int8_t numbers[26 * 36] = {};
+
+    constexpr AbbreviationTable() {
+        for (auto &number: numbers) number = -1;
+        for (const auto &abbreviation: REGISTER_ABRV) {
+            if (abbreviation.name.size() != 3) continue;
+            numbers[abbreviationSlot(abbreviation.name[1], abbreviation.name[2])] = abbreviation.number;
+        }
+    }
+} REGISTER_SLOTS;
+
+/**
+ * @brief Decodes a register name without allocating, by character compares
+ * and a table lookup.
+ *
+ * @param s register name, e.g. "$14" or "$t1"
+ * @return RegisterCode the register number and REGISTER_OK or the reason
+ * why s is no register. For REGISTER_OUT_OF_RANGE number is the index.
+ */
+constexpr RegisterCode decodeRegister(std::string_view s) {
+    if (s == "$zero") return {REGISTER_OK, 0};
+    if (s.size() != 3 || s[0] != '$') return {REGISTER_INVALID, 0};
+
+    const char first = s[1];
+    const char second = s[2];
+    if (isDecimal(first) && isDecimal(second)) {
+        const uint32_t number = (first - '0') * 10 + (second - '0');
+        if (number > 31) return {REGISTER_OUT_OF_RANGE, number};
+        return {REGISTER_OK, number};
+    }
+    if (!isLowerAlpha(first) || !(isLowerAlpha(second) || isDecimal(second))) {
+        return {REGISTER_INVALID, 0};
+    }
+
+    const int8_t number = REGISTER_SLOTS.numbers[abbreviationSlot(first, second)];
+    if (number < 0) return {REGISTER_UNSUPPORTED, 0};
+    return {REGISTER_OK, static_cast<uint32_t>(number)};
+}
+
+static_assert(decodeRegister("$sp").number == 29 && decodeRegister("$07").number == 7);
+static_assert(decodeRegister("$7").status == REGISTER_INVALID);
+static_assert(decodeRegister("$40").status == REGISTER_OUT_OF_RANGE);
+static_assert(decodeRegister("$xy").status == REGISTER_UNSUPPORTED);
+
 #endif
@@ -0,0 +1,735 @@
+#include "incremental.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache.hpp"
+#include "instruction.hpp"
+#include "lexer.hpp"
+#include "passes.hpp"
+#include "source.hpp"
+#include "stats.hpp"
+#include "symbols.hpp"
+#include "trace.hpp"
+
+namespace {
+
+// changes whenever the layout of the state file changes
+constexpr char STATE_MAGIC[8] = {'M', 'I', 'P', 'S', 'I', 'N', 'C', '2'};
+
+// an output that needs more patches than this is written again as a whole
+constexpr size_t MAX_PATCHES = 256;
+
+// where the fields of an instruction are in its listing line
+constexpr size_t LISTING_ADDRESS = 2;
+constexpr size_t LISTING_WORD = 16;
+
+// size and modification time of an output, changes if anybody writes it
+struct FileStamp {
+    uint64_t size = 0;
+    int64_t seconds = 0;
+    int64_t nanoseconds = 0;
+
+    bool operator==(const FileStamp &other) const {
+        return size == other.size && seconds == other.seconds && nanoseconds == other.nanoseconds;
+    }
+};
+
+bool fileStamp(const std::string &path, FileStamp &stamp) {
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) return false;
+    stamp.size = static_cast<uint64_t>(info.st_size);
+    stamp.seconds = info.st_mtim.tv_sec;
+    stamp.nanoseconds = info.st_mtim.tv_nsec;
+    return true;
+}
+
+// a source line of the last run
+struct StateLine {
+    uint64_t hash;     // contentHash of the line
+    uint64_t listing;  // offset of its line in the listing
+    int32_t address;   // address of its instruction
+    uint32_t word;     // index of its instruction in the instruction output
+    // address of a label on it, unlike instructions it also moves on lines
+    // of labels only (firstPass)
+    int32_t label_address;
+    uint32_t unused;  // keeps the record free of padding
+};
+static_assert(sizeof(StateLine) == 32, "lines are written as they are in memory");
+
+struct StateLabel {
+    uint32_t line;           // 0-based
+    int32_t address;
+    uint32_t hash;           // labelHash of the label without the ':'
+    std::string_view label;  // including the ':'
+};
+
+// a "j" or "beq" that names a label
+struct StateBranch {
+    uint32_t line;           // 0-based
+    uint32_t hash;           // labelHash of the label
+    int32_t immediate;       // the resolved target
+    bool jump;               // "j", otherwise "beq"
+    std::string_view label;
+};
+
+struct IncrementalState {
+    uint32_t format = OUTPUT_FORMAT_HEX;
+    uint32_t big_endian = 1;
+    FileStamp listing;
+    FileStamp instructions;
+    std::vector<StateLine> lines;  // every source line and one behind the last with the totals
+    std::vector<StateLabel> labels;
+    std::vector<StateBranch> branches;
+    std::vector<char> names;  // the labels of a loaded state point into it
+};
+
+// --------------------------------------------------------
+
+template <typename T>
+void put(std::string &text, const T &value) {
+    text.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+/**
+ * @brief The state file: header, the names of all labels, then the lines, the
+ * labels and the branches as fixed size records. Numbers are in the byte
+ * order of the machine, the state never leaves it.
+ */
+std::string stateText(const IncrementalState &state) {
+    std::string names;
+    for (const auto &label: state.labels) names += label.label;
+    for (const auto &branch: state.branches) names += branch.label;
+
+    std::string text;
+    text.reserve(sizeof(STATE_MAGIC) + 96 + names.size() + state.lines.size() * sizeof(StateLine) +
+                 state.labels.size() * 16 + state.branches.size() * 20);
+    text.append(STATE_MAGIC, sizeof(STATE_MAGIC));
+    put(text, state.format);
+    put(text, state.big_endian);
+    for (const FileStamp *stamp: {&state.listing, &state.instructions}) {
+        put(text, stamp->size);
+        put(text, stamp->seconds);
+        put(text, stamp->nanoseconds);
+    }
+    put<uint64_t>(text, state.lines.size());
+    put<uint64_t>(text, state.labels.size());
+    put<uint64_t>(text, state.branches.size());
+    put<uint64_t>(text, names.size());
+    text += names;
+    text.append(reinterpret_cast<const char *>(state.lines.data()), state.lines.size() * sizeof(StateLine));
+    for (const auto &label: state.labels) {
+        put(text, label.line);
+        put(text, label.address);
+        put(text, label.hash);
+        put<uint32_t>(text, label.label.size());
+    }
+    for (const auto &branch: state.branches) {
+        put(text, branch.line);
+        put(text, branch.hash);
+        put(text, branch.immediate);
+        put<uint32_t>(text, branch.jump);
+        put<uint32_t>(text, branch.label.size());
+    }
+    return text;
+}
+
+/**
+ * @brief Reads the records of a state file, every read checks that there is
+ * enough left.
+ */
+class StateReader {
+public:
+    explicit StateReader(std::string_view text) : rest_(text) {}
+
+    template <typename T>
+    bool get(T &value) {
+        if (rest_.size() < sizeof(T)) return false;
+        std::memcpy(&value, rest_.data(), sizeof(T));
+        rest_.remove_prefix(sizeof(T));
+        return true;
+    }
+
+    bool bytes(size_t size, std::string_view &value) {
+        if (rest_.size() < size) return false;
+        value = rest_.substr(0, size);
+        rest_.remove_prefix(size);
+        return true;
+    }
+
+    bool done() const { return rest_.empty(); }
+
+private:
+    std::string_view rest_;
+};
+
+/**
+ * @brief Takes the next size bytes of the names, in the order stateText
+ * wrote them.
+ */
+bool takeName(const IncrementalState &state, size_t &used, uint32_t size, std::string_view &name) {
+    if (size > state.names.size() - used) return false;
+    name = std::string_view(state.names.data() + used, size);
+    used += size;
+    return true;
+}
+
+bool parseState(std::string_view text, IncrementalState &state) {
+    StateReader reader(text);
+    std::string_view magic;
+    if (!reader.bytes(sizeof(STATE_MAGIC), magic) || magic != std::string_view(STATE_MAGIC, sizeof(STATE_MAGIC))) {
+        return false;
+    }
+    uint64_t line_count = 0, label_count = 0, branch_count = 0, names_size = 0;
+    if (!reader.get(state.format) || !reader.get(state.big_endian)) return false;
+    for (FileStamp *stamp: {&state.listing, &state.instructions}) {
+        if (!reader.get(stamp->size) || !reader.get(stamp->seconds) || !reader.get(stamp->nanoseconds)) return false;
+    }
+    std::string_view names, lines;
+    if (!reader.get(line_count) || !reader.get(label_count) || !reader.get(branch_count) ||
+        !reader.get(names_size) || line_count == 0 || !reader.bytes(names_size, names) ||
+        line_count > text.size() / sizeof(StateLine) || !reader.bytes(line_count * sizeof(StateLine), lines)) {
+        return false;
+    }
+    state.names.assign(names.begin(), names.end());
+    state.lines.resize(line_count);
+    std::memcpy(state.lines.data(), lines.data(), lines.size());
+
+    size_t used = 0;
+    state.labels.resize(std::min<uint64_t>(label_count, text.size()));
+    for (auto &label: state.labels) {
+        uint32_t size = 0;
+        if (!reader.get(label.line) || !reader.get(label.address) || !reader.get(label.hash) ||
+            !reader.get(size) || !takeName(state, used, size, label.label) || label.line >= line_count - 1) {
+            return false;
+        }
+    }
+    state.branches.resize(std::min<uint64_t>(branch_count, text.size()));
+    for (auto &branch: state.branches) {
+        uint32_t size = 0, jump = 0;
+        if (!reader.get(branch.line) || !reader.get(branch.hash) || !reader.get(branch.immediate) ||
+            !reader.get(jump) || !reader.get(size) || !takeName(state, used, size, branch.label) ||
+            branch.line >= line_count - 1) {
+            return false;
+        }
+        branch.jump = jump != 0;
+    }
+    return reader.done() && used == state.names.size() && state.labels.size() == label_count &&
+           state.branches.size() == branch_count;
+}
+
+/**
+ * @brief Replaces the state file, through a temporary file so an interrupted
+ * run never leaves half a state behind.
+ */
+void writeState(const std::string &path, const IncrementalState &state) {
+    const std::string temporary = path + ".tmp." + std::to_string(::getpid());
+    const std::string text = stateText(state);
+    const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) return;
+    std::string_view rest = text;
+    while (!rest.empty()) {
+        const ssize_t count = ::write(fd, rest.data(), rest.size());
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) break;
+        rest.remove_prefix(count);
+    }
+    if (::close(fd) != 0 || !rest.empty() || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+    }
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Appends the lines of text to state the way the second pass reads
+ * them. The listing offsets are filled in by listingOffsets, the targets of
+ * the branches by resolveBranches.
+ *
+ * @param first_line number of source lines before text
+ * @param address address of the first instruction in text, the address
+ * behind the last one afterwards
+ * @param word index of the first instruction in text, the index behind the
+ * last one afterwards
+ * @param label_address address of a label on the first line of text, the
+ * one behind the last line afterwards
+ * @return bool false if a line of text can't be assembled
+ */
+bool scanLines(std::string_view text,
+               uint32_t first_line,
+               int &address,
+               uint32_t &word,
+               int &label_address,
+               IncrementalState &state) {
+    LineReader fileReader(text);
+    std::string_view currentLine;
+    Instruction instruction;
+    uint32_t line = first_line;
+    while (fileReader.next(currentLine)) {
+        const LineTokens tokens = lexLine(currentLine);
+        if (!parseInstruction(tokens, instruction) || instruction.kind == INSTRUCTION_INVALID) return false;
+        state.lines.push_back({contentHash(currentLine, 0), 0, address, word, label_address, 0});
+        if (!tokens.label.empty()) {
+            state.labels.push_back({line, label_address, tokens.label_hash, tokens.label});
+        }
+        if (instruction.kind == INSTRUCTION_CODE) {
+            if (!instruction.jump_label.empty()) {
+                state.branches.push_back({line, instruction.jump_hash, 0, instruction.parts[0] == "j",
+                                          instruction.jump_label});
+            }
+            ++word;
+            if (!tokens.label_single) address += 4;
+        }
+        // like firstPass: a line of labels only, such as "a: b:", moves the
+        // labels behind it without an instruction
+        if (tokens.has_code && !tokens.label_single) label_address += 4;
+        ++line;
+    }
+    return true;
+}
+
+/**
+ * @brief Fills in where the listing lines of the lines [begin, end) start.
+ * Every source line is listed on exactly one line.
+ *
+ * @param listing the listing of the lines, it may go on behind them
+ * @param base offset of listing in the whole listing
+ * @param used receives the bytes of listing the lines take
+ * @return bool false if listing has fewer lines
+ */
+bool listingOffsets(std::vector<StateLine> &lines,
+                    size_t begin,
+                    size_t end,
+                    std::string_view listing,
+                    uint64_t base,
+                    size_t &used) {
+    used = 0;
+    for (size_t i = begin; i < end; ++i) {
+        lines[i].listing = base + used;
+        const size_t line_end = listing.find('\n', used);
+        if (line_end == std::string_view::npos) return false;
+        used = line_end + 1;
+    }
+    return true;
+}
+
+/**
+ * @brief Symbol table of the labels in source order, with a warning for
+ * every label defined more than once.
+ */
+void defineLabels(const std::vector<StateLabel> &labels, SymbolTable &symbols, std::vector<Diagnostic> &warnings) {
+    for (const auto &label: labels) {
+        defineLabel(symbols, label.label, label.hash, label.address, label.line + 1, warnings);
+    }
+}
+
+/**
+ * @brief Copies the symbols into the result sorted by name, like assemble().
+ */
+void resultSymbols(SymbolTable &symbols, AssemblyResult &result) {
+    symbols.sort();
+    result.symbols.reserve(symbols.size());
+    for (const auto &lbl: symbols.symbols()) {
+        result.symbols.push_back({std::string(lbl.name), lbl.address});
+    }
+}
+
+/**
+ * @brief Target of a branch as resolveLabel computes it.
+ */
+int branchImmediate(const StateBranch &branch, int labelAddr, int address) {
+    return branch.jump ? labelAddr / 4 : (labelAddr - address - 4) / 4;
+}
+
+/**
+ * @brief State of a program that was assembled without errors.
+ *
+ * @param listing the listing that was written for source
+ * @return bool false if source and listing don't fit together
+ */
+bool scanState(std::string_view source, std::string_view listing, IncrementalState &state) {
+    int address = 0, label_address = 0;
+    uint32_t word = 0;
+    if (!scanLines(source, 0, address, word, label_address, state)) return false;
+    state.lines.push_back({0, 0, address, word, label_address, 0});
+
+    size_t used = 0;
+    if (!listingOffsets(state.lines, 0, state.lines.size() - 1, listing, 0, used)) return false;
+    state.lines.back().listing = used;
+
+    SymbolTable symbols;
+    std::vector<Diagnostic> warnings;
+    defineLabels(state.labels, symbols, warnings);
+    for (auto &branch: state.branches) {
+        const int *labelAddr = symbols.find(branch.label, branch.hash);
+        if (labelAddr == nullptr) return false;
+        branch.immediate = branchImmediate(branch, *labelAddr, state.lines[branch.line].address);
+    }
+    return true;
+}
+
+// --------------------------------------------------------
+
+// bytes that replace a fixed-width field of an output
+struct Patch {
+    uint64_t offset;
+    uint32_t size;
+    char bytes[8];
+};
+
+Patch hexPatch(uint64_t offset, uint32_t value) {
+    Patch patch{offset, 8, {}};
+    for (int i = 7; i >= 0; --i, value >>= 4) {
+        patch.bytes[i] = "0123456789abcdef"[value & 0xF];
+    }
+    return patch;
+}
+
+/**
+ * @brief Patch of instruction index in the instruction output.
+ */
+Patch wordPatch(const IncrementalState &state, uint32_t index, uint32_t word) {
+    if (state.format != OUTPUT_FORMAT_BIN) return hexPatch(11ull * index + 2, word);
+    Patch patch{4ull * index, 4, {}};
+    for (int i = 0; i < 4; ++i) {
+        const int shift = state.big_endian ? 24 - 8 * i : 8 * i;
+        patch.bytes[i] = static_cast<char>((word >> shift) & 0xFF);
+    }
+    return patch;
+}
+
+bool writeAt(int fd, uint64_t offset, std::string_view data) {
+    TraceSpan span("write");
+    addStat(STATS_BYTES_WRITTEN, data.size());
+    traceCount("bytes written", data.size());
+    while (!data.empty()) {
+        const ssize_t count = ::pwrite(fd, data.data(), data.size(), static_cast<off_t>(offset));
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) return false;
+        data.remove_prefix(count);
+        offset += count;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes an output that differs from its old contents in the range
+ * [begin, end), in everything behind tail_begin and in a couple of patched
+ * fields. The file is overwritten from begin on and never truncated first,
+ * bytes in front of begin are only written where they are patched.
+ *
+ * @param old_contents what the output holds now
+ * @param replacement new contents of [begin, end)
+ * @param tail new contents behind tail_begin
+ * @param patches fields to overwrite, at offsets of the new contents
+ */
+bool updateOutput(const std::string &path,
+                  std::string_view old_contents,
+                  size_t begin,
+                  size_t end,
+                  std::string_view replacement,
+                  size_t tail_begin,
+                  std::string_view tail,
+                  const std::vector<Patch> &patches) {
+    const size_t size = begin + replacement.size() + (tail_begin - end) + tail.size();
+    const size_t patches_in_front = std::count_if(patches.begin(), patches.end(), [begin](const Patch &patch) {
+        return patch.offset < begin;
+    });
+    // same size and only a few patches: just the bytes that changed
+    const bool in_place = size == old_contents.size() && replacement.size() == end - begin &&
+                          tail == old_contents.substr(tail_begin) && patches.size() <= MAX_PATCHES;
+    const size_t first = in_place || patches_in_front <= MAX_PATCHES ? begin : 0;
+
+    std::string contents;
+    if (!in_place) {
+        contents.reserve(size - first);
+        contents.append(old_contents.substr(first, begin - first));
+        contents.append(replacement);
+        contents.append(old_contents.substr(end, tail_begin - end));
+        contents.append(tail);
+    }
+    const int fd = ::open(path.c_str(), O_WRONLY);
+    if (fd < 0) return false;
+    bool written = true;
+    if (in_place) {
+        written = replacement == old_contents.substr(begin, end - begin) || writeAt(fd, begin, replacement);
+    }
+    for (const auto &patch: patches) {
+        if (patch.offset + patch.size > size) {
+            written = false;
+        } else if (in_place || patch.offset < first) {
+            written = written && writeAt(fd, patch.offset, {patch.bytes, patch.size});
+        } else {
+            std::memcpy(&contents[patch.offset - first], patch.bytes, patch.size);
+        }
+    }
+    if (!in_place) {
+        written = written && writeAt(fd, first, contents);
+        if (size < old_contents.size()) written = written && ::ftruncate(fd, static_cast<off_t>(size)) == 0;
+    }
+    return ::close(fd) == 0 && written;
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Assembles source by updating the outputs of the run state describes
+ * and writes the state of this run.
+ *
+ * @param state the state of the last run
+ * @param state_path receives the state of this run
+ * @param result receives symbols and warnings
+ * @return bool false if the outputs can't be reused, they have to be written
+ * by a full assembly then
+ */
+bool reassemble(std::string_view source,
+                const BatchJob &job,
+                const IncrementalState &state,
+                const std::string &state_path,
+                AssemblyResult &result) {
+    FileStamp listing_stamp, instructions_stamp;
+    if (!fileStamp(job.listing, listing_stamp) || !(listing_stamp == state.listing) ||
+        !fileStamp(job.instructions, instructions_stamp) || !(instructions_stamp == state.instructions)) {
+        return false;
+    }
+    const std::vector<StateLine> &old_lines = state.lines;
+    const size_t old_count = old_lines.size() - 1;
+    const uint64_t word_bytes = state.format == OUTPUT_FORMAT_BIN ? 4 : 11;
+    if (state.instructions.size != old_lines.back().word * word_bytes) return false;
+
+    // 1. the lines that are unchanged at the start and at the end
+    std::vector<size_t> line_starts;  // of the unchanged lines at the start
+    size_t region_begin = 0;
+    while (region_begin < source.size() && line_starts.size() < old_count) {
+        const size_t end = std::min(source.find('\n', region_begin), source.size());
+        if (contentHash(source.substr(region_begin, end - region_begin), 0) != old_lines[line_starts.size()].hash) break;
+        line_starts.push_back(region_begin);
+        region_begin = std::min(end + 1, source.size());
+    }
+    const size_t prefix = line_starts.size();
+
+    std::vector<size_t> suffix_starts;  // of the unchanged lines at the end, last line first
+    size_t region_end = source.size();
+    size_t line_end = !source.empty() && source.back() == '\n' ? source.size() - 1 : source.size();
+    while (region_end > region_begin && suffix_starts.size() < old_count - prefix) {
+        const size_t newline = line_end == 0 ? std::string_view::npos : source.rfind('\n', line_end - 1);
+        const size_t begin = newline == std::string_view::npos ? 0 : newline + 1;
+        if (begin < region_begin) break;
+        if (contentHash(source.substr(begin, line_end - begin), 0) != old_lines[old_count - 1 - suffix_starts.size()].hash) break;
+        suffix_starts.push_back(begin);
+        region_end = begin;
+        if (begin == 0) break;
+        line_end = begin - 1;
+    }
+    const size_t suffix = suffix_starts.size();
+    const size_t old_region_end = old_count - suffix;
+
+    SymbolTable symbols;
+    if (prefix == old_count && region_begin == source.size()) {
+        // nothing changed, neither the outputs nor the state
+        defineLabels(state.labels, symbols, result.warnings);
+        result.ok = true;
+        resultSymbols(symbols, result);
+        return true;
+    }
+
+    // 2. the lines in between, with the labels and branches of all lines
+    IncrementalState next;
+    next.format = state.format;
+    next.big_endian = state.big_endian;
+    next.lines.assign(old_lines.begin(), old_lines.begin() + prefix);
+    for (const auto &label: state.labels) {
+        if (label.line < prefix) next.labels.push_back(label);
+    }
+    for (const auto &branch: state.branches) {
+        if (branch.line < prefix) next.branches.push_back(branch);
+    }
+    const std::string_view region = source.substr(region_begin, region_end - region_begin);
+    int address = old_lines[prefix].address;
+    uint32_t word = old_lines[prefix].word;
+    int label_address = old_lines[prefix].label_address;
+    if (!scanLines(region, prefix, address, word, label_address, next)) return false;
+    const size_t new_region_end = next.lines.size();
+    const size_t new_count = new_region_end + suffix;
+
+    // the lines behind move by the same amount
+    const int address_shift = address - old_lines[old_region_end].address;
+    const int label_shift = label_address - old_lines[old_region_end].label_address;
+    const int64_t word_shift = static_cast<int64_t>(word) - old_lines[old_region_end].word;
+    const int64_t line_shift = static_cast<int64_t>(new_count) - static_cast<int64_t>(old_count);
+    for (size_t i = old_region_end; i <= old_count; ++i) {
+        StateLine line = old_lines[i];
+        line.address += address_shift;
+        line.label_address += label_shift;
+        line.word = static_cast<uint32_t>(line.word + word_shift);
+        next.lines.push_back(line);
+    }
+    for (const auto &label: state.labels) {
+        if (label.line < old_region_end) continue;
+        next.labels.push_back({static_cast<uint32_t>(label.line + line_shift), label.address + label_shift,
+                               label.hash, label.label});
+    }
+    for (const auto &branch: state.branches) {
+        if (branch.line < old_region_end) continue;
+        StateBranch moved = branch;
+        moved.line = static_cast<uint32_t>(branch.line + line_shift);
+        next.branches.push_back(moved);
+    }
+
+    defineLabels(next.labels, symbols, result.warnings);
+
+    // 3. encode the lines in between
+    std::string region_listing, region_words;
+    {
+        OutputBuffer listing, words;
+        listing.openString(region_listing);
+        words.openString(region_words);
+        InstructionOutput instructions(words, state.format, state.big_endian != 0);
+        try {
+            encodeLines(region, prefix, old_lines[prefix].address, listing, instructions, symbols, true);
+        } catch (const AssemblyError &) {
+            return false;
+        }
+        instructions.finish();
+    }
+    size_t used = 0;
+    if (!listingOffsets(next.lines, prefix, new_region_end, region_listing, old_lines[prefix].listing, used) ||
+        used != region_listing.size() || region_words.size() != (word - old_lines[prefix].word) * word_bytes) {
+        return false;
+    }
+    const int64_t listing_shift = static_cast<int64_t>(region_listing.size()) -
+                                  static_cast<int64_t>(old_lines[old_region_end].listing - old_lines[prefix].listing);
+    for (size_t i = new_region_end; i <= new_count; ++i) {
+        next.lines[i].listing += listing_shift;
+    }
+
+    // 4. the lines behind have moved, jumps and branches may point elsewhere
+    std::vector<Patch> listing_patches, instruction_patches;
+    if (address_shift != 0) {
+        for (size_t i = new_region_end; i < new_count; ++i) {
+            if (next.lines[i + 1].word == next.lines[i].word) continue;
+            listing_patches.push_back(hexPatch(next.lines[i].listing + LISTING_ADDRESS, next.lines[i].address));
+        }
+    }
+    std::string error_text;
+    OutputBuffer errout;
+    errout.openString(error_text);
+    for (auto &branch: next.branches) {
+        const int *labelAddr = symbols.find(branch.label, branch.hash);
+        if (labelAddr == nullptr) return false;
+        const StateLine &line = next.lines[branch.line];
+        const int immediate = branchImmediate(branch, *labelAddr, line.address);
+        const bool encoded = branch.line >= prefix && branch.line < new_region_end;
+        if (!encoded && immediate != branch.immediate) {
+            // the line is unchanged, its text is found through its start
+            const size_t start = branch.line < prefix ? line_starts[branch.line]
+                                                      : suffix_starts[new_count - 1 - branch.line];
+            const std::string_view text = source.substr(start, std::min(source.find('\n', start), source.size()) - start);
+            Instruction instruction;
+            if (!parseInstruction(lexLine(text), instruction) || instruction.jump_label.empty()) return false;
+            resolveLabel(instruction, *labelAddr, line.address);
+            uint32_t binary_instruction = 0;
+            try {
+                binary_instruction = binInstruction(instruction, errout);
+            } catch (const AssemblyError &) {
+                return false;
+            }
+            listing_patches.push_back(hexPatch(line.listing + LISTING_WORD, binary_instruction));
+            instruction_patches.push_back(wordPatch(next, line.word, binary_instruction));
+        }
+        branch.immediate = immediate;
+    }
+
+    // 5. write what changed
+    std::string symbols_text;
+    {
+        OutputBuffer listing;
+        listing.openString(symbols_text);
+        symbolsOutputPrinting(listing, symbols);
+    }
+    {
+        SourceFile listingReader, instructionsReader;
+        if (!listingReader.open(job.listing) || !instructionsReader.open(job.instructions) ||
+            listingReader.contents().size() != state.listing.size ||
+            instructionsReader.contents().size() != state.instructions.size) {
+            return false;
+        }
+        const std::string_view old_listing = listingReader.contents();
+        const std::string_view old_words = instructionsReader.contents();
+        if (!updateOutput(job.listing, old_listing, old_lines[prefix].listing, old_lines[old_region_end].listing,
+                          region_listing, old_lines.back().listing, symbols_text, listing_patches) ||
+            !updateOutput(job.instructions, old_words, old_lines[prefix].word * word_bytes,
+                          old_lines[old_region_end].word * word_bytes, region_words, old_words.size(), {},
+                          instruction_patches)) {
+            return false;
+        }
+    }
+    if (!fileStamp(job.listing, next.listing) || !fileStamp(job.instructions, next.instructions)) return false;
+
+    result.ok = true;
+    resultSymbols(symbols, result);
+    // the labels of next point into the old state and the source
+    writeState(state_path, next);
+    return true;
+}
+
+}  // namespace
+
+// --------------------------------------------------------
+
+AssemblyResult assembleIncremental(std::string_view source,
+                                   const BatchJob &job,
+                                   const BatchOptions &options,
+                                   const std::string &state_path) {
+    const bool files = job.listing != "-" && job.instructions != "-";
+    if (files) {
+        IncrementalState state;
+        SourceFile stateReader;
+        AssemblyResult result;
+        if (stateReader.open(state_path) && parseState(stateReader.contents(), state) &&
+            state.format == static_cast<uint32_t>(options.format) &&
+            state.big_endian == static_cast<uint32_t>(options.big_endian) &&
+            reassemble(source, job, state, state_path, result)) {
+            return result;
+        }
+    }
+
+    // full assembly
+    AssemblyResult result;
+    {
+        OutputBuffer outputListing;
+        OutputBuffer outputInstructions;
+        if (!outputListing.open(job.listing) || !outputInstructions.open(job.instructions)) {
+            result.diagnostics.push_back({0, "Error: Output could not be created for: " + job.source + "\n"});
+            return result;
+        }
+        outputListing.writeInBackground();
+        outputInstructions.writeInBackground();
+        InstructionOutput instructions(outputInstructions, options.format, options.big_endian);
+        AssemblyOptions assembly = options.assembly;
+        assembly.jobs = options.jobs;
+        result = assemble(source, assembly, outputListing, instructions);
+        closeOutputs(job, outputListing, outputInstructions, result);
+    }
+
+    IncrementalState state;
+    state.format = options.format;
+    state.big_endian = options.big_endian;
+    SourceFile listingReader;
+    if (files && result.ok && listingReader.open(job.listing) &&
+        scanState(source, listingReader.contents(), state) &&
+        fileStamp(job.listing, state.listing) && fileStamp(job.instructions, state.instructions)) {
+        writeState(state_path, state);
+    } else {
+        // a state that doesn't describe the outputs anymore must not be used
+        std::remove(state_path.c_str());
+    }
+    return result;
+}
@@ -0,0 +1,33 @@
+#ifndef MIPS_INCREMENTAL_H
+#define MIPS_INCREMENTAL_H
+
+#include <string>
+#include <string_view>
+
+#include "assembler.hpp"
+#include "batch.hpp"
+
+/**
+ * @brief Assembles a program whose outputs were written by an earlier run and
+ * reuses them. The state file keeps a hash of every source line, the address,
+ * listing position and instruction index of every line, the labels and the
+ * jumps and branches to labels. Lines that are unchanged at the start and at
+ * the end of the source keep their outputs: only the lines in between are
+ * encoded, addresses of moved lines and words of jumps and branches whose
+ * targets moved are patched in place. Everything else (no or a stale state,
+ * outputs changed since, any error) runs the full assembly and writes a new
+ * state for the next run.
+ *
+ * @param source the raw instructions
+ * @param job source and output paths, outputs on stdout are always assembled
+ * in full
+ * @param options how to assemble and write the outputs
+ * @param state_path the state file, replaced after every run
+ * @return AssemblyResult symbols and diagnostics like assemble()
+ */
+AssemblyResult assembleIncremental(std::string_view source,
+                                   const BatchJob &job,
+                                   const BatchOptions &options,
+                                   const std::string &state_path);
+
+#endif
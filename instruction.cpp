@@ -0,0 +1,170 @@
+#include "instruction.hpp"
+
+#include <climits>
+
+#include "symbols.hpp"
+
+namespace {
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+/**
+ * @brief Decodes the part the format reads as a number, with the range of
+ * stoi: the number has to fit into an int.
+ */
+void decodeImmediate(Instruction &instruction, size_t part) {
+    const ParsedNumber number = parseNumber(instruction.parts[part]);
+    instruction.immediate = static_cast<int>(number.value);
+    instruction.immediate_valid = number.digits && number.value >= INT_MIN && number.value <= INT_MAX;
+}
+
+/**
+ * @brief Looks up the mnemonic and decodes the operands the way the format of
+ * the instruction uses them. Whatever doesn't fit the format is left for
+ * binInstruction to report.
+ */
+void decodeOperands(Instruction &instruction) {
+    instruction.exit = instruction.parts[0] == "exit";
+    instruction.entry = INSTR_TABLE.find(instruction.parts[0]);
+    if (instruction.exit || instruction.entry == nullptr) return;
+
+    const size_t count = instruction.part_count;
+    const bool has_immediate = instruction.number_part != 0 || !instruction.jump_label.empty();
+    switch (instruction.entry->codes.format) {
+        case INSTR_TYPE_R:
+            for (size_t i = 1; i < count; ++i) {
+                instruction.registers[i] = decodeRegister(instruction.parts[i]);
+            }
+            break;
+
+        case INSTR_TYPE_R_SHIFT:
+        case INSTR_TYPE_I:
+            if (count != 4) break;
+            instruction.registers[1] = decodeRegister(instruction.parts[1]);
+            instruction.registers[2] = decodeRegister(instruction.parts[2]);
+            if (!has_immediate) decodeImmediate(instruction, 3);
+            break;
+
+        case INSTR_TYPE_J:
+            if (count == 2 && !has_immediate) decodeImmediate(instruction, 1);
+            break;
+
+        default:
+            break;
+    }
+}
+
+}  // namespace
+
+// --------------------------------------------------------
+
+ParsedNumber parseNumber(std::string_view s) {
+    ParsedNumber number;
+    size_t i = 0;
+    while (i < s.size() && isSpace(s[i])) ++i;
+    const bool negative = i < s.size() && s[i] == '-';
+    if (i < s.size() && (s[i] == '-' || s[i] == '+')) ++i;
+
+    // strtol saturates at LONG_MIN and LONG_MAX
+    const unsigned long limit = negative ? static_cast<unsigned long>(LONG_MAX) + 1 : LONG_MAX;
+    unsigned long magnitude = 0;
+    bool overflow = false;
+    for (; i < s.size() && s[i] >= '0' && s[i] <= '9'; ++i) {
+        number.digits = true;
+        const unsigned long digit = s[i] - '0';
+        if (overflow || magnitude > (limit - digit) / 10) {
+            overflow = true;
+        } else {
+            magnitude = magnitude * 10 + digit;
+        }
+    }
+    if (!number.digits) {
+        // nothing was converted, strtol points at the start again
+        number.complete = s.empty();
+        return number;
+    }
+    if (overflow) magnitude = limit;
+    number.value = negative ? static_cast<long>(0 - magnitude) : static_cast<long>(magnitude);
+    number.complete = i == s.size();
+    return number;
+}
+
+// --------------------------------------------------------
+
+bool parseInstruction(const LineTokens &tokens, Instruction &instruction) {
+    instruction = Instruction();
+    const auto &fields = tokens.fields;
+    auto &parts = instruction.parts;
+    switch (tokens.shape) {
+        case LINE_SHAPE_ONE:
+            parts[0] = fields[0];
+            instruction.part_count = 1;
+            break;
+
+        case LINE_SHAPE_TWO:
+            parts[0] = fields[0];
+            parts[1] = fields[1];
+            instruction.part_count = 2;
+            if (fields[0] == "j") {
+                const ParsedNumber target = parseNumber(fields[1]);
+                if (target.complete) {  // input is already integer
+                    instruction.immediate = static_cast<int>(target.value);
+                    instruction.immediate_valid = true;
+                    instruction.number_part = 1;
+                } else {  // input is a label
+                    instruction.jump_label = fields[1];
+                    instruction.jump_hash = labelHash(fields[1]);
+                }
+            }
+            break;
+
+        case LINE_SHAPE_MEMORY:
+            // {instr, rt, base, offset}
+            parts[0] = fields[0];
+            parts[1] = fields[1];
+            parts[2] = fields[3];
+            parts[3] = fields[2];
+            instruction.part_count = 4;
+            break;
+
+        case LINE_SHAPE_THREE:
+            parts[0] = fields[0];
+            instruction.part_count = 4;
+            if (fields[0] == "beq") {
+                const ParsedNumber offset = parseNumber(fields[3]);
+                if (static_cast<int>(offset.value) > 0xFFFF) {
+                    return false;
+                }
+                parts[1] = fields[2];  // special order for beq and bne
+                parts[2] = fields[1];
+                parts[3] = fields[3];
+                if (offset.complete) {  // input is already integer
+                    instruction.immediate = static_cast<int>(offset.value);
+                    instruction.immediate_valid = true;
+                    instruction.number_part = 3;
+                } else {  // input is a label
+                    instruction.jump_label = fields[3];
+                    instruction.jump_hash = labelHash(fields[3]);
+                }
+            } else {
+                parts[1] = fields[1];
+                parts[2] = fields[2];
+                parts[3] = fields[3];
+            }
+            break;
+
+        default:
+            // code that is neither a label nor a known layout
+            if (tokens.has_code && tokens.label.empty()) {
+                instruction.kind = INSTRUCTION_INVALID;
+            }
+            return true;
+    }
+
+    // "err" used to mark invalid lines and is still treated as one
+    instruction.kind = parts[0] == "err" ? INSTRUCTION_INVALID : INSTRUCTION_CODE;
+    if (instruction.kind == INSTRUCTION_CODE) decodeOperands(instruction);
+    return true;
+}
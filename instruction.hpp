@@ -0,0 +1,60 @@
+#ifndef MIPS_INSTRUCTION_H
+#define MIPS_INSTRUCTION_H
+
+#include <string_view>
+
+#include "definitions.hpp"
+#include "lexer.hpp"
+
+// what parseInstruction found on a source line
+enum {
+    INSTRUCTION_NONE,    // nothing to encode, label and comment only
+    INSTRUCTION_CODE,    // an instruction, it may still fail to encode
+    INSTRUCTION_INVALID  // code that fits no instruction layout
+};
+
+// a number read like strtol reads it in base 10
+struct ParsedNumber {
+    long value = 0;         // LONG_MIN or LONG_MAX if out of range, 0 without digits
+    bool digits = false;    // at least one digit was read
+    bool complete = false;  // nothing follows the number
+};
+
+/**
+ * @brief Reads a number the way strtol does in base 10: leading whitespace,
+ * an optional sign and as many digits as there are.
+ */
+ParsedNumber parseNumber(std::string_view s);
+
+/**
+ * @brief An instruction of a source line, decoded once. The parts point into
+ * the source and are only kept for the listing and error messages, registers
+ * and the immediate are stored decoded, so encoding and listing an instruction
+ * neither allocates nor converts strings.
+ */
+struct Instruction {
+    int kind = INSTRUCTION_NONE;
+    const InstructionEntry *entry = nullptr;  // nullptr for unknown mnemonics
+    bool exit = false;                        // "exit", encoded as 0xFFFFFFFF
+    size_t part_count = 0;                    // mnemonic and operands: 1, 2 or 4
+    std::string_view parts[4];                // as written, in the order the encoder reads them
+    RegisterCode registers[4];                // parts that are registers for the format
+    int immediate = 0;                        // shift amount, immediate, offset or jump target
+    bool immediate_valid = false;             // false if the number part is no int
+    size_t number_part = 0;                   // part listed as the immediate instead of its text, 0 for none
+    std::string_view jump_label;              // label a "j" or "beq" jumps to, empty if none
+    uint32_t jump_hash = 0;                   // labelHash(jump_label)
+};
+
+/**
+ * @brief Decodes the instruction of a lexed line. A "j" or "beq" that names a
+ * label gets the label in jump_label, resolveLabel fills in the immediate.
+ *
+ * @param tokens the lexed source line
+ * @param instruction receives the instruction, INSTRUCTION_INVALID if the line
+ * can't be an instruction
+ * @return bool false if the offset of a "beq" is too long
+ */
+bool parseInstruction(const LineTokens &tokens, Instruction &instruction);
+
+#endif
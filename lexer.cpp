@@ -0,0 +1,194 @@
+#include "lexer.hpp"
+
+#include "symbols.hpp"
+
+namespace {
+
+// at most "op arg, arg, arg" split at whitespace, one more marks a line that
+// is too long
+constexpr size_t MAX_TOKENS = 5;
+
+struct TokenList {
+    std::string_view tokens[MAX_TOKENS];
+    size_t count = 0;
+};
+
+// same characters as \s in the default "C" locale
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Moves behind the character at position pos of token tok. The
+ * operand layouts allow whitespace after every ',' so leaving a token simply
+ * continues at the start of the next one.
+ */
+void advance(size_t &tok, size_t &pos, const std::string_view *tokens) {
+    if (++pos == tokens[tok].size()) {
+        ++tok;
+        pos = 0;
+    }
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Matches "arg, offset(base)" against the operand tokens. Whenever the
+ * first argument contains several commas the rightmost one that leads to a
+ * match is used, exactly like a greedy "(\S+)," would.
+ *
+ * @param ops operand tokens (everything behind the mnemonic)
+ * @param count number of operand tokens
+ * @param out receives arg, offset and base in fields[1..3]
+ * @return true if the operands have the memory layout
+ */
+bool matchMemory(const std::string_view *ops, size_t count, LineTokens &out) {
+    const std::string_view first = ops[0];
+    for (size_t comma = first.size() - 1; comma >= 1; --comma) {
+        if (first[comma] != ',') continue;
+
+        size_t tok = 0;
+        size_t pos = comma;
+        advance(tok, pos, ops);
+        // "offset(base)" has to be the remainder of the line
+        if (tok != count - 1) continue;
+
+        const std::string_view rest = ops[tok].substr(pos);
+        size_t digits = 0;
+        while (digits < rest.size() && isDigit(rest[digits])) ++digits;
+        if (digits == 0 || digits + 2 >= rest.size()) continue;
+        if (rest[digits] != '(' || rest.back() != ')') continue;
+
+        out.fields[1] = first.substr(0, comma);
+        out.fields[2] = rest.substr(0, digits);
+        out.fields[3] = rest.substr(digits + 1, rest.size() - digits - 2);
+        return true;
+    }
+    return false;
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Matches "arg, arg, arg" against the operand tokens. Commas inside
+ * the arguments are resolved the same way a backtracking
+ * "(\S+),\s*(\S+),\s*(\S+)" would do it.
+ *
+ * @param ops operand tokens (everything behind the mnemonic)
+ * @param count number of operand tokens
+ * @param out receives the three arguments in fields[1..3]
+ * @return true if the operands have the three argument layout
+ */
+bool matchThree(const std::string_view *ops, size_t count, LineTokens &out) {
+    const std::string_view first = ops[0];
+    for (size_t comma1 = first.size() - 1; comma1 >= 1; --comma1) {
+        if (first[comma1] != ',') continue;
+
+        size_t tok2 = 0;
+        size_t pos2 = comma1;
+        advance(tok2, pos2, ops);
+        if (tok2 == count) continue;
+
+        const std::string_view second = ops[tok2];
+        for (size_t comma2 = second.size() - 1; comma2 >= pos2 + 1; --comma2) {
+            if (second[comma2] != ',') continue;
+
+            size_t tok3 = tok2;
+            size_t pos3 = comma2;
+            advance(tok3, pos3, ops);
+            // the last argument has to be the remainder of the line
+            if (tok3 != count - 1) continue;
+
+            out.fields[1] = first.substr(0, comma1);
+            out.fields[2] = second.substr(pos2, comma2 - pos2);
+            out.fields[3] = ops[tok3].substr(pos3);
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+// --------------------------------------------------------
+
+LineTokens lexLine(std::string_view line, bool comments) {
+    LineTokens out;
+
+    // The comment starts at the last '#' before the line ends or a '\r'
+    // appears, the code ends at the first '#'.
+    const size_t first_hash = line.find('#');
+    if (comments && first_hash != std::string_view::npos) {
+        size_t comment_end = line.find('\r', first_hash);
+        if (comment_end == std::string_view::npos) comment_end = line.size();
+        const size_t comment_begin = line.rfind('#', comment_end - 1);
+        out.comment = line.substr(comment_begin, comment_end - comment_begin);
+    }
+    const std::string_view code = line.substr(0, first_hash);
+
+    // Split the code at whitespace. The first token that contains a ':' is the
+    // label. Everything up to the last ':' of any token is dropped from the
+    // operands.
+    TokenList ops;
+    size_t i = 0;
+    while (true) {
+        while (i < code.size() && isSpace(code[i])) ++i;
+        if (i == code.size()) break;
+
+        const size_t begin = i;
+        while (i < code.size() && !isSpace(code[i])) ++i;
+        std::string_view token = code.substr(begin, i - begin);
+
+        if (!out.label.empty()) out.label_single = false;
+        out.has_code = true;
+
+        const size_t last_colon = token.rfind(':');
+        if (last_colon != std::string_view::npos) {
+            if (out.label.empty()) {
+                out.label = token.substr(0, last_colon + 1);
+                out.label_hash = labelHash(token.substr(0, last_colon));
+                out.label_single = token.find(':') == token.size() - 1;
+            }
+            token.remove_prefix(last_colon + 1);
+            if (token.empty()) continue;
+        }
+
+        if (ops.count == MAX_TOKENS) continue;
+        ops.tokens[ops.count++] = token;
+    }
+
+    switch (ops.count) {
+        case 0:
+            out.shape = out.has_code ? LINE_SHAPE_INVALID : LINE_SHAPE_NONE;
+            return out;
+        case 1:
+            out.shape = LINE_SHAPE_ONE;
+            out.fields[0] = ops.tokens[0];
+            return out;
+        case 2:
+            out.shape = LINE_SHAPE_TWO;
+            out.fields[0] = ops.tokens[0];
+            out.fields[1] = ops.tokens[1];
+            return out;
+        case 3:
+        case 4:
+            out.fields[0] = ops.tokens[0];
+            if (ops.count == 3 && matchMemory(ops.tokens + 1, 2, out)) {
+                out.shape = LINE_SHAPE_MEMORY;
+            } else if (matchThree(ops.tokens + 1, ops.count - 1, out)) {
+                out.shape = LINE_SHAPE_THREE;
+            } else {
+                out.shape = LINE_SHAPE_INVALID;
+            }
+            return out;
+        default:
+            out.shape = LINE_SHAPE_INVALID;
+            return out;
+    }
+}
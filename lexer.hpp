@@ -0,0 +1,39 @@
+#ifndef MIPS_LEXER_H
+#define MIPS_LEXER_H
+
+#include <cstdint>
+#include <string_view>
+
+// operand layouts a source line can have
+enum {
+    LINE_SHAPE_NONE,     // no instruction on the line
+    LINE_SHAPE_ONE,      // "op"
+    LINE_SHAPE_TWO,      // "op arg"
+    LINE_SHAPE_MEMORY,   // "op arg, offset(arg)"
+    LINE_SHAPE_THREE,    // "op arg, arg, arg"
+    LINE_SHAPE_INVALID   // instruction that fits none of the layouts above
+};
+
+struct LineTokens {
+    std::string_view comment;    // comment including its '#'
+    std::string_view label;      // label including its ':'
+    uint32_t label_hash = 0;     // labelHash of the label without its ':'
+    bool has_code = false;       // something else than a comment on the line
+    bool label_single = false;   // nothing follows the label
+    int shape = LINE_SHAPE_NONE;
+    std::string_view fields[4];  // mnemonic and operands in source order
+};
+
+/**
+ * @brief Splits a single source line into label, mnemonic, operands and
+ * comment. The line is walked once and all returned views point into it.
+ *
+ * @param line one line of the source file without its line break
+ * @param comments false leaves the comment empty, only the listing shows it
+ * @return LineTokens the parts of the line. For LINE_SHAPE_MEMORY the fields
+ * are {op, arg, offset, base}, otherwise the fields are in the order they
+ * appear in the line.
+ */
+LineTokens lexLine(std::string_view line, bool comments = true);
+
+#endif
@@ -1,490 +1,294 @@
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
-#include <iomanip>
 #include <iostream>
-#include <map>
-#include <regex>
+#include <string>
 #include <vector>
-#include <stdexcept>
 
-#include "definitions.hpp"
-
-/**
- * @brief First pass to find the addresses for each lable that occur.
- *
- * @param fileReader input file stream of the file that contains the raw
- * instructions
- * @param labelAddrMap reference to the map that will store the numerical
- * addresses of each label
- */
-void firstPass(std::ifstream &fileReader, std::map<std::string, int> &labelAddrMap) {
-    std::string currentLine;
-    unsigned int addrPointer = 0;
-    std::smatch match;
-    std::regex regex1(R"(^\s*[^\s#]+\s*#*)");
-    std::regex regex2("[^#]*");
-    std::regex regex3("\\S*(?=:)");
-    std::regex regex4(":[^#]*[^#\\s]#*");
-
-    while (getline(fileReader, currentLine)) {
-        bool labelSingle = false;
-        // Looking for lines with codes
-        if (std::regex_search(currentLine, regex1)) {
-            // Looking for code without comments (we keep everything before a #)
-            if (std::regex_search(currentLine, match, regex2)) {
-                std::string lineWithoutComments = match.str(0);
-                // Looking for a label name
-                if (std::regex_search(lineWithoutComments, match, regex3)) {
-                    labelAddrMap[match.str(0)] = addrPointer;
-
-                    // Looking if there is no code after the label
-                    if (!std::regex_search(lineWithoutComments, regex4)) {
-                        labelSingle = true;
-                    }
-                }
-                if (!labelSingle) addrPointer += 4;
-            }
-        }
-    }
+#include <sys/resource.h>
+
+#include "assembler.hpp"
+#include "batch.hpp"
+#include "cache.hpp"
+#include "incremental.hpp"
+#include "source.hpp"
+#include "stats.hpp"
+#include "stream.hpp"
+#include "trace.hpp"
+
+// most worker threads --jobs asks for
+constexpr size_t MAX_JOBS = 1024;
+
+void printUsage(const char *executable) {
+    std::cerr << "usage: " << executable << " [options] inputfile output_listing output_instructions\n"
+              << "       " << executable << " --batch [options] list_file|directory output_directory\n"
+              << "       " << executable << " --no-listing [options] inputfile output_instructions\n"
+              << "       " << executable << " --stream [options] [inputfile [output_instructions]]\n"
+              << "options: --one-pass --format=hex|bin --endian=big|little --jobs=N --cache-dir=DIR --stats\n"
+              << "         --incremental=STATE_FILE (not with --batch) --trace=TRACE_FILE\n";
 }
 
 // --------------------------------------------------------
 
 /**
- * @brief Converts a register abbreviation into the numerical index of the
- * corresponding register.
+ * @brief Collects the sources of a batch.
  *
- * @param s String that contains the register abbreviation. Must begin with '$'
- * followed by either the numeric index or the alphanumerical abbreviation. E.g.
- * "$14" or "$t1".
- * @param errout Reference to a file output stream where the error message
- * should be printed to.
- * @return uint32_t the numerical index of the corresponding register. 0, if an
- * error occured.
+ * @param path either a directory, whose regular files are the sources, or a
+ * file that lists one source path per line
+ * @param sources receives the source paths
+ * @return bool false if path can't be read
  */
-uint32_t regCode(const std::string &s, std::ofstream &errout) {
-    if (!std::regex_match(s, std::regex(R"([$](zero|[0-9]{2}|[a-z]\d|[a-z]{2}))"))) {
-        errout << "Error: Register string invalid: " << s << ". Abort ...\n";
-        errout.close();
-        exit(EXIT_FAILURE);
-    }
-
-    uint32_t register_number = 0;
-    if (s[1] >= 48 &&
-        s[1] <= 57) {  // there is a number after $ -> no abbreviations
-        register_number = stoi(s.substr(1, s.length() - 1));
-        if (register_number < 0 || register_number > 31) {
-            errout << "Error: Register out of range: " << register_number << ". Abort ...\n";
-            errout.close();
-            exit(EXIT_FAILURE);
+bool batchSources(const std::string &path, std::vector<std::string> &sources) {
+    std::error_code error;
+    if (std::filesystem::is_directory(path, error)) {
+        for (const auto &entry: std::filesystem::directory_iterator(path, error)) {
+            if (entry.is_regular_file()) sources.push_back(entry.path().string());
         }
-        return register_number;
+        std::sort(sources.begin(), sources.end());
+        return !error;
     }
 
-    // register abbreviations
-    const auto result = REGISTER_ABRV.find(s);
-    if (result == REGISTER_ABRV.end()) {
-        errout << "Error: Register abbreviation not supported: " << s << ". Abort ...\n";
-        errout.close();
-        exit(EXIT_FAILURE);
+    std::ifstream listReader(path);
+    if (!listReader.is_open()) return false;
+    std::string currentLine;
+    while (getline(listReader, currentLine)) {
+        if (!currentLine.empty()) sources.push_back(currentLine);
     }
+    return true;
+}
 
-    return result->second;
+/**
+ * @brief Writes diagnostics to stderr, prefixed with source and line.
+ */
+void printDiagnostics(const std::string &source, const std::vector<Diagnostic> &diagnostics) {
+    for (const auto &diagnostic: diagnostics) {
+        std::cerr << source << ":" << diagnostic.line << ": " << diagnostic.message;
+    }
 }
 
 // --------------------------------------------------------
 
 /**
- * @brief Converts a MIPS instruction into its binary form.
+ * @brief Assembles every source of a batch and reports the errors on stderr.
  *
- * @param instruction_parts a valid MIPS instruction that was split into its
- * parts so it won't containt any whitespaces or other seperators. E.g. "add
- * $t2, $t1, $t1" has to be split into {"add", "$t2", "$t1", "$t1"}
- * @param errout Reference to a file output stream where the error message
- * should be printed to.
- * @return uint32_t binary MIPS instruction
+ * @return int exit code, EXIT_FAILURE if any program failed
  */
-uint32_t binInstruction(const std::vector<std::string> &instruction_parts, std::ofstream &errout) {
-    size_t argument_cnt = instruction_parts.size();
-    if (argument_cnt == 0) {
-        errout << "Error: Empty instruction can't be converted to binary. Abort ...\n";
-        errout.close();
-        exit(EXIT_FAILURE);
+int runBatch(const std::string &input, const std::string &output_dir, const BatchOptions &options) {
+    std::vector<std::string> sources;
+    if (!batchSources(input, sources)) {
+        std::cerr << "Error: " << input << " is neither a directory nor a readable list of sources\n";
+        return EXIT_FAILURE;
     }
 
-    if(instruction_parts[0] == "exit"){
-        return ~0u;
+    const std::vector<BatchJob> jobs = batchJobs(sources, output_dir, options.format);
+    size_t first, second;
+    if (findDuplicateOutputs(jobs, first, second)) {
+        std::cerr << "Error: " << jobs[first].source << " and " << jobs[second].source
+                  << " would both be written to " << jobs[second].instructions << "\n";
+        return EXIT_FAILURE;
     }
-
-    // find codes and layout for instruction
-    const auto result = INSTR_CODES.find(instruction_parts[0]);
-    if (result == INSTR_CODES.end()) {
-        errout << "Error: Instruction " << instruction_parts[0] << " is not supported. Abort ...\n";
-        errout.close();
-        exit(EXIT_FAILURE);
+    const std::vector<AssemblyResult> results = assembleBatch(jobs, options);
+
+    size_t failed = 0;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        printDiagnostics(jobs[i].source, results[i].warnings);
+        if (results[i].ok) continue;
+        ++failed;
+        printDiagnostics(jobs[i].source, results[i].diagnostics);
     }
-    InstructionCodes instruction_codes = result->second;
-
-    // 1. op-code - first (left) 6 bits
-    uint32_t binary_instr = 0x00000000;
-    binary_instr |= instruction_codes.op_code << 26;
-
-    // 2. parse arguments
-    switch (instruction_codes.format) {
-        case INSTR_TYPE_R:
-            if (argument_cnt == 2) {  // jr instruction
-                binary_instr |= regCode(instruction_parts[1], errout) << 21;
-                binary_instr |= instruction_codes.function;
-                break;
-            }
-
-            if (argument_cnt != 4) {
-                errout << "Error: Wrong amount of arguments for instruction type R: " << argument_cnt << ".\n";
-                errout.close();
-                exit(EXIT_FAILURE);
-            }
-
-            binary_instr |= regCode(instruction_parts[2], errout) << 21;  // rs
-            binary_instr |= regCode(instruction_parts[3], errout) << 16;  // rt
-            binary_instr |= regCode(instruction_parts[1], errout) << 11;  // rd
-            binary_instr |= instruction_codes.function;  // func. code
-            break;
-
-        case INSTR_TYPE_R_SHIFT:
-            if (argument_cnt != 4) {
-                errout << "Error: Wrong amount of arguments for instruction type R: " << argument_cnt << ".\n";
-                errout.close();
-                exit(EXIT_FAILURE);
-            }
-
-            binary_instr |= regCode(instruction_parts[2], errout) << 16;  // rt
-            binary_instr |= regCode(instruction_parts[1], errout) << 11;  // rd
-            binary_instr |= stoi(instruction_parts[3]) << 6;              // sh
-            binary_instr |= instruction_codes.function;  // func. code
-            break;
-
-        case INSTR_TYPE_I:
-            if (argument_cnt != 3 && argument_cnt != 4) {
-                errout << "Error: Wrong amount of arguments for instruction type I: " << argument_cnt << ".\n";
-                errout.close();
-                exit(EXIT_FAILURE);
-            }
-
-            if(stoi(instruction_parts[3]) > 0xFFFF){
-                errout << "Error: Argument too long.\n";
-                errout.close();
-                exit(EXIT_FAILURE);
-            }
-
-            // format: {instr, rt, rs, imm} or {instr, rt, rs, offset}
-            binary_instr |= regCode(instruction_parts[2], errout) << 21;  // rs
-            binary_instr |= regCode(instruction_parts[1], errout) << 16;  // rt
-            binary_instr |= stoi(instruction_parts[3]) & 0xFFFF;  // imm or offset
-            break;
-
-        case INSTR_TYPE_J:
-            if (argument_cnt != 2) {
-                errout << "Error: Wrong amount of arguments for instruction type J: " << argument_cnt << ".\n";
-                errout.close();
-                exit(EXIT_FAILURE);
-            }
-
-            if(stoi(instruction_parts[1]) > 0x3FFFFFF){
-                errout << "Error: Jump address too long.\n";
-                errout.close();
-                exit(EXIT_FAILURE);
-            }
-
-            binary_instr |= stoi(instruction_parts[1]) & 0x3FFFFFF;
-            break;
-
-        case INSTR_TYPE_NULL:
-        default:
-            binary_instr = 0u;
-            break;
+    if (failed != 0) {
+        std::cerr << failed << " of " << jobs.size() << " programs failed\n";
+        return EXIT_FAILURE;
     }
-
-    return binary_instr;
+    return 0;
 }
 
 // --------------------------------------------------------
 
 /**
- * @brief outputPrinting generates the two output files after the execution
- * of the second pass
+ * @brief Assembles a program while it is read, by default from stdin to
+ * stdout, and reports on stderr how much of it was held in memory.
  *
- * @param outputListing output file stream for the file containing the listing
- * @param outputInstructions output file stream for the file containing the
- * instructions
- * @param result contain the parts of the MIPS instruction to handle
- * @param comment contain the comment if there is one on the line
- * @param label contain the label which is placed at the beginning of the line
- * if there is one
- * @param labelCall in case of instruction "j" or "beq", contain the label
- * name to jump to
- * @param instruction_count contain the current instruction address
- * @param labelSingle is true if a label is the only element on the line
- * (doesn't take into account potential comment)
+ * @param paths the source and the instruction file, both optional
+ * @return int exit code, EXIT_FAILURE if the program failed
  */
-void outputPrinting(std::ofstream &outputListing,
-            std::ofstream &outputInstructions,
-            std::vector<std::string> &result,
-            std::string &comment,
-            std::string &label,
-            std::string &labelCall,
-            int &instruction_count,
-            bool &labelSingle) {
-    if (!result.empty() && result[0] == "err") {
-        outputListing << "Error: Wrong amount of arguments, operation not supported" << ".\n";
-        outputListing.close();
-        exit(EXIT_FAILURE);
-    } else {
-        if (result.size() != 0) {
-            uint32_t binary_instruction = binInstruction(result, outputListing);
-
-            // output listing
-            std::ios hex_format(nullptr);
-            outputListing << "0x";
-            outputListing << std::hex << std::setw(8) << std::setfill('0');
-            hex_format.copyfmt(outputListing);
-            outputListing << instruction_count;
-            outputListing << "    0x";
-            outputListing.copyfmt(hex_format);
-            outputListing << binary_instruction;
-            if (label.empty()) {
-                outputListing << "                  ";
-            } else {
-                outputListing << "    ";
-                outputListing << std::left << std::setw(10) << std::setfill(' ') << label << std::right;
-                outputListing << "    ";
-            }
-            if (result[0] == "sw" || result[0] == "lw") {
-                outputListing << result[0] << " " << result[1] << " " << result[3] << "(" << result[2] << ") ";
-            } else if (result[0] == "j" && !labelCall.empty()) {
-                outputListing << result[0] << " " << labelCall << " ";
-            } else if (result[0] == "beq" && !labelCall.empty()) {
-                outputListing << result[0] << " " << result[2] << " " << result[1] << " " << labelCall << " ";
-            } else {
-                for (const auto &s: result) {
-                    outputListing << s << " ";
-                }
-            }
-            if (!comment.empty()) {
-                outputListing << "    ";
-                outputListing << comment;
-            }
-            outputListing << "\n";
-
-            // output instructions
-            outputInstructions << "0x";
-            outputInstructions.copyfmt(hex_format);
-            outputInstructions << binary_instruction << "\n";
-            if (!labelSingle) instruction_count += 4;
-        } else {
-            if (!label.empty() || !comment.empty()) {
-                outputListing << "                            ";
-            }
-            if (!label.empty()) {
-                outputListing << label;
-            }
-            if (!comment.empty()) {
-                if (!label.empty()) {
-                    outputListing << "    ";
-                }
-                outputListing << comment;
-            }
-            outputListing << "\n";
-        }
+int runStream(const std::vector<std::string> &paths, const BatchOptions &options) {
+    const std::string input = paths.size() > 0 ? paths[0] : "-";
+    const std::string output = paths.size() > 1 && paths[1] != "-" ? paths[1] : "stdout";
+    OutputBuffer outputInstructions;
+    if (!outputInstructions.open(paths.size() > 1 ? paths[1] : "-")) {
+        std::cerr << "Error: Output could not be created for: " << input << "\n";
+        return EXIT_FAILURE;
+    }
+    outputInstructions.writeInBackground();
+
+    StreamReport report;
+    AssemblyResult result = assembleStream(input, outputInstructions, options.format, options.big_endian, report);
+    if (!outputInstructions.close()) {
+        result.ok = false;
+        result.diagnostics.push_back(
+            {0, "Error: " + output + " could not be written: " + std::strerror(outputInstructions.error()) + "\n"});
     }
+    // there is no listing, errors go to stderr as well
+    printDiagnostics(input, result.warnings);
+    printDiagnostics(input, result.diagnostics);
+
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    std::cerr << "stream: " << report.lines << " lines, " << report.words << " instructions written, "
+              << "at most " << report.max_waiting_words << " words (" << report.max_waiting_bytes
+              << " source bytes) waiting for labels, longest line " << report.max_line_bytes
+              << " bytes, peak memory " << usage.ru_maxrss << " KB\n";
+    return result.ok ? 0 : EXIT_FAILURE;
 }
 
 // --------------------------------------------------------
 
 /**
- * @brief symbolsOutputPrinting print the symbols at the ends of the listing
- * file when the outputPrinting function has finished
+ * @brief Assembles a single program.
  *
- * @param outputListing output file stream for the file containing the listing
- * @param labelAddrMap reference to a map that holds the numerical addresses for
- * each label
+ * @param paths the source, the listing unless options.assembly.listing is
+ * false, and the instruction file
+ * @return int exit code, EXIT_FAILURE if the program failed
  */
-void symbolsOutputPrinting(std::ofstream &outputListing, std::map<std::string, int> &labelAddrMap) {
-    outputListing << "\nSymbols\n";
-    for (const auto &lbl: labelAddrMap) {
-        outputListing << std::left << std::setw(13) << std::setfill(' ');
-        outputListing << lbl.first << " ";
-        outputListing << "0x";
-        outputListing << std::hex << std::right << std::setw(8) << std::setfill('0');
-        outputListing << lbl.second;
-        outputListing << "\n";
+int runProgram(const std::vector<std::string> &paths, BatchOptions options) {
+    const bool listing = options.assembly.listing;
+    // open files
+    SourceFile fileReader;
+    {
+        PhaseTimer timer(STATS_READ);
+        fileReader.open(paths[0]);
     }
-}
 
-// --------------------------------------------------------
-
-/**
- * @brief Tries to convert a given string into an integer and 
- * checks if that string can be converted into an integer at all.
- * 
- * @param s string
- * @return std::pair<bool, int> first: bool, if the string can be
- * converted to an integer; second: converted integer value, 0 if 
- * conversion failed
- */
-std::pair<bool, int> strtoi_safe(const std::string& s){
-    char* p;
-    int x = strtol(s.c_str(), &p, 10);
-    return {*p == 0, x};
-}
-
-// --------------------------------------------------------
-
-/**
- * @brief Second pass to validate the instructions, handle comments, split the
- * instructions into their parts and eventually convert and print them.
- *
- * @param fileReader input file stream of the file that contains the raw
- * instructions
- * @param outputListing output file stream for the file containing the listing
- * @param outputInstructions output file stream for the file containing the
- * instructions
- * @param labelAddrMap reference to a map that holds the numerical addresses for
- * each label
- */
-void secondPass(std::ifstream &fileReader,
-                std::ofstream &outputListing,
-                std::ofstream &outputInstructions,
-                std::map<std::string, int> &labelAddrMap) {
-    fileReader.clear();
-    fileReader.seekg(0);
-    std::string currentLine;
-    int instruction_count = 0;
-    std::smatch match;
-    std::regex regex1(R"(.*(#.*))");
-    std::regex regex2((R"(^\s*[^\s#]+\s*#*)"));
-    std::regex regex3("[^#]*");
-    std::regex regex4((R"(\S*:)"));
-    std::regex regex5(":[^#]*[^#\\s]#*");
-    std::regex regex6(R"(\S*:)");
-    std::regex firstMatch(R"(^\s*(\S+)\s*$)");
-    std::regex secondMatch(R"(^\s*(\S+)\s+(\S+)\s*$)");
-    std::regex thirdMatch(R"(^\s*(\S+)\s+(\S+),\s*(\d+)\((\S+)\)\s*$)");
-    std::regex fourthMatch(R"(^\s*(\S+)\s+(\S+),\s*(\S+),\s*(\S+)\s*$)");
+    // a cached program only needs its outputs copied
+    const BatchJob job{paths[0], listing ? paths[1] : std::string(), paths.back()};
+    std::string cache_key;
+    if (fileReader.is_open() && !options.cache_dir.empty()) {
+        cache_key = cacheKey(fileReader.contents(), options);
+        AssemblyResult cached;
+        if (loadCached(options.cache_dir, cache_key, job, cached)) {
+            printDiagnostics(paths[0], cached.warnings);
+            return cached.ok ? 0 : EXIT_FAILURE;
+        }
+    }
 
-    while (getline(fileReader, currentLine)) {
-        bool labelSingle = false;
-        std::string lineWithoutComments;
-        std::string comment;
-        std::string label;
-        std::vector<std::string> result = {};
-        std::string labelCall;
-        if (std::regex_search(currentLine, match, regex1)) {
-            comment = match.str(1);
+    // the outputs of the last run are updated where the source changed
+    if (fileReader.is_open() && !options.incremental_state.empty()) {
+        const AssemblyResult result = assembleIncremental(fileReader.contents(), job, options, options.incremental_state);
+        printDiagnostics(paths[0], result.warnings);
+        // errors on line 0 have no place in the listing, like outputs that
+        // could not be written
+        for (const auto &diagnostic: result.diagnostics) {
+            if (diagnostic.line == 0) printDiagnostics(paths[0], {diagnostic});
         }
-        // Looking for lines with codes
-        if (std::regex_search(currentLine, regex2)) {
-            // Looking for code without comments (we keep everything before a #)
-            if (std::regex_search(currentLine, match, regex3)) {
-                lineWithoutComments = match.str(0);
-                // Looking for a label name
-                if (std::regex_search(lineWithoutComments, match, regex4)) {
-                    label = match.str(0);
-                    // Looking if there is no code after the label
-                    if (!std::regex_search(lineWithoutComments, regex5)) {
-                        labelSingle = true;
-                    }
-                    lineWithoutComments = std::regex_replace(lineWithoutComments, regex6, "");
-                }
-                if (std::regex_search(lineWithoutComments, match, firstMatch)) {
-                    result = {match.str(1)};
-                } else if (std::regex_search(lineWithoutComments, match, secondMatch)) {
-                    if (match.str(1) == "j") {
-                        auto converted_string = strtoi_safe(match.str(2));
-                        if(converted_string.first){ // input is already integer
-                            result = {match.str(1), std::to_string(converted_string.second)};
-                        }else{ // input is a label
-                            auto map_result = labelAddrMap.find(match.str(2));
-                            if (map_result == labelAddrMap.end()) {
-                                outputListing << "Error: label '" << match.str(2)
-                                            << "' does not exist!" << std::endl;
-                                outputListing.close();
-                                exit(EXIT_FAILURE);
-                            }
-                            result = {match.str(1), std::to_string(map_result->second / 4)};
-                            labelCall = match.str(2);
-                        }
-                    } else {
-                        result = {match.str(1), match.str(2)};
-                    }
-                } else if (std::regex_search(lineWithoutComments, match, thirdMatch)) {
-                    result = {match.str(1), match.str(2), match.str(4), match.str(3)};
-                } else if (std::regex_search(lineWithoutComments, match, fourthMatch)) {
-                    if (match.str(1) == "beq") {
-                        auto converted_string = strtoi_safe(match.str(4));
+        if (!cache_key.empty()) storeCached(options.cache_dir, cache_key, job, result);
+        return result.ok ? 0 : EXIT_FAILURE;
+    }
 
-                        if(converted_string.second > 0xFFFF){
-                            outputListing << "Error: Argument too long.\n";
-                            outputListing.close();
-                            exit(EXIT_FAILURE);
-                        }
+    // without listing the buffer stays closed, it still decides how numbers
+    // in error messages are written
+    OutputBuffer outputListing;
+    if (listing) outputListing.open(paths[1]);
+    OutputBuffer outputInstructions;
+    outputInstructions.open(paths.back());
+    if(!fileReader.is_open() || !outputInstructions.is_open() || (listing && !outputListing.is_open())){
+        return 1;
+    }
+    // encoding goes on while the files are written, both at the same time
+    outputListing.writeInBackground();
+    outputInstructions.writeInBackground();
+    InstructionOutput instructions(outputInstructions, options.format, options.big_endian);
+
+    // a single large program uses the threads for its second pass
+    options.assembly.jobs = options.jobs;
+    AssemblyResult result = assemble(fileReader.contents(), options.assembly, outputListing, instructions);
+    // errors are written into the listing, warnings have no place there
+    printDiagnostics(paths[0], result.warnings);
+    if (!listing) printDiagnostics(paths[0], result.diagnostics);
 
-                        if(converted_string.first){ // input is already integer
-                            result = {
-                                match.str(1),
-                                match.str(3),  // special order for beq and bne
-                                match.str(2),
-                                std::to_string(converted_string.second)
-                            };
-                        }else{ // input is a label
-                            auto map_result = labelAddrMap.find(match.str(4));
-                            if (map_result == labelAddrMap.end()) {
-                                outputListing << "Error: label '" << match.str(4)
-                                            << "' does not exist!" << std::endl;
-                                outputListing.close();
-                                exit(EXIT_FAILURE);
-                            }
-                            result = {
-                                    match.str(1),
-                                    match.str(3),  // special order for beq and bne
-                                    match.str(2),
-                                    std::to_string((map_result->second - instruction_count - 4) / 4)
-                            };
-                            labelCall = match.str(4);
-                        }
-                    } else {
-                        result = {match.str(1), match.str(2), match.str(3), match.str(4)};
-                    }
-                } else if (label.empty()) {
-                    result = {"err"};
-                }
-            }
-        }
-        outputPrinting(outputListing, outputInstructions, result, comment, label, labelCall, instruction_count, labelSingle);
+    fileReader.close();
+    const size_t errors = result.diagnostics.size();
+    if (!closeOutputs(job, outputListing, outputInstructions, result)) {
+        printDiagnostics(paths[0], {result.diagnostics.begin() + errors, result.diagnostics.end()});
+        return EXIT_FAILURE;
     }
-    symbolsOutputPrinting(outputListing, labelAddrMap);
+    if (!cache_key.empty()) storeCached(options.cache_dir, cache_key, job, result);
+    return result.ok ? 0 : EXIT_FAILURE;
 }
 
 // --------------------------------------------------------
 
 int main(int argc, char* argv[]) {
-    // call like "./executable inputfile output_listing output_instructions"
-    if(argc != 4){
-        return 1;
+    // call like "./executable [options] inputfile output_listing output_instructions"
+    // the inputfile may be "-" to read from stdin
+    BatchOptions options;
+    bool batch = false;
+    bool stream = false;
+    bool stats = false;
+    std::string trace_path;
+    bool valid_options = true;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--one-pass") {
+            options.assembly.one_pass = true;
+        } else if (arg == "--format=hex") {
+            options.format = OUTPUT_FORMAT_HEX;
+        } else if (arg == "--format=bin") {
+            options.format = OUTPUT_FORMAT_BIN;
+        } else if (arg == "--endian=big") {
+            options.big_endian = true;
+        } else if (arg == "--endian=little") {
+            options.big_endian = false;
+        } else if (arg == "--batch") {
+            batch = true;
+        } else if (arg == "--stream") {
+            stream = true;
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg == "--no-listing") {
+            options.assembly.listing = false;
+        } else if (arg.rfind("--jobs=", 0) == 0) {
+            // 1 to MAX_JOBS, anything else is a usage error
+            size_t jobs = 0;
+            const auto [end, error] = std::from_chars(arg.data() + 7, arg.data() + arg.size(), jobs);
+            if (error != std::errc() || end != arg.data() + arg.size() || jobs == 0 || jobs > MAX_JOBS) {
+                valid_options = false;
+            }
+            options.jobs = jobs;
+        } else if (arg.rfind("--cache-dir=", 0) == 0 && arg.size() > 12) {
+            options.cache_dir = arg.substr(12);
+        } else if (arg.rfind("--incremental=", 0) == 0 && arg.size() > 14) {
+            options.incremental_state = arg.substr(14);
+        } else if (arg.rfind("--trace=", 0) == 0 && arg.size() > 8) {
+            trace_path = arg.substr(8);
+        } else if (arg.size() > 1 && arg[0] == '-' && arg[1] == '-') {
+            valid_options = false;
+        } else {
+            paths.push_back(arg);
+        }
     }
-
-    // open files
-    std::ifstream fileReader(argv[1]);
-    std::ofstream outputListing(argv[2]);
-    std::ofstream outputInstructions(argv[3]);
-    if(!fileReader.is_open() || !outputInstructions.is_open() || ! outputListing.is_open()){
+    const bool listing = options.assembly.listing;
+    const bool stream_usage = !batch && paths.size() <= 2 && options.cache_dir.empty() && options.incremental_state.empty();
+    // cache entries and incremental states always hold a listing
+    const bool listing_usage = listing || (options.cache_dir.empty() && options.incremental_state.empty());
+    if (!valid_options || (stream ? !stream_usage : paths.size() != (batch || !listing ? 2 : 3)) ||
+        (batch && !options.incremental_state.empty()) || !listing_usage) {
+        printUsage(argv[0]);
         return 1;
     }
 
-    std::map<std::string, int> labelAddrMap;
-
-    firstPass(fileReader, labelAddrMap);
-    secondPass(fileReader, outputListing, outputInstructions, labelAddrMap);
-    fileReader.close();
-    outputListing.close();
-    outputInstructions.close();
-    return 0;
+    if (stats) enableStats();
+    if (!trace_path.empty()) startTrace();
+    int status = stream ? runStream(paths, options)
+                 : batch ? runBatch(paths[0], paths[1], options)
+                 : runProgram(paths, options);
+    if (stats) std::cerr << statsReport();
+    if (!trace_path.empty() && !writeTrace(trace_path)) {
+        std::cerr << "Error: trace could not be written to " << trace_path << "\n";
+        status = EXIT_FAILURE;
+    }
+    return status;
 }
@@ -0,0 +1,272 @@
+#include "output.hpp"
+
+#include <cerrno>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "stats.hpp"
+#include "trace.hpp"
+
+namespace {
+
+// two hex digits for every byte value
+struct HexPairs {
+    char digits[256][2] = {};
+
+    constexpr HexPairs() {
+        constexpr char HEX_DIGITS[] = "0123456789abcdef";
+        for (int i = 0; i < 256; ++i) {
+            digits[i][0] = HEX_DIGITS[i >> 4];
+            digits[i][1] = HEX_DIGITS[i & 0xF];
+        }
+    }
+};
+
+constexpr HexPairs HEX_PAIRS;
+
+/**
+ * @brief Writes all of data.
+ *
+ * @return int 0, or the errno of the write that failed
+ */
+int writeAll(int fd, const char *data, size_t size) {
+    TraceSpan span("write");
+    addStat(STATS_BYTES_WRITTEN, size);
+    traceCount("bytes written", size);
+    while (size > 0 && fd >= 0) {
+        const ssize_t count = ::write(fd, data, size);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) return errno;
+        data += count;
+        size -= count;
+    }
+    return 0;
+}
+
+}  // namespace
+
+// --------------------------------------------------------
+
+/**
+ * @brief Thread that writes the buffers of an OutputBuffer. It holds one
+ * buffer at a time: submit hands over a full buffer and gets back the one
+ * written before, so there are two buffers that take turns.
+ */
+class BackgroundWriter {
+public:
+    explicit BackgroundWriter(int fd) : fd_(fd), thread_([this] { run(); }) {}
+
+    ~BackgroundWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        submitted_.notify_one();
+        thread_.join();
+    }
+
+    /**
+     * @brief Waits for the last buffer.
+     *
+     * @return int 0, or the errno of the first write that failed
+     */
+    int finish() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        written_.wait(lock, [this] { return !busy_; });
+        return error_;
+    }
+
+    /**
+     * @brief Swaps buffer with the one of the thread, after the thread has
+     * written that one.
+     */
+    void submit(std::string &buffer) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (busy_) {
+            // the encoder outran the disk
+            TraceSpan span("waitForWriter");
+            written_.wait(lock, [this] { return !busy_; });
+        }
+        pending_.swap(buffer);
+        busy_ = true;
+        submitted_.notify_one();
+    }
+
+private:
+    void run() {
+        traceThreadName("writer");
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            submitted_.wait(lock, [this] { return busy_ || stopping_; });
+            // stopping_ is only set after the last submit
+            if (!busy_) return;
+            lock.unlock();
+            // nothing is written behind a failed write
+            const int error = error_ == 0 ? writeAll(fd_, pending_.data(), pending_.size()) : error_;
+            lock.lock();
+            error_ = error;
+            busy_ = false;
+            written_.notify_one();
+        }
+    }
+
+    const int fd_;
+    std::string pending_;  // belongs to the thread while busy_
+    bool busy_ = false;
+    bool stopping_ = false;
+    int error_ = 0;        // errno of the first failed write
+    std::mutex mutex_;
+    std::condition_variable submitted_;
+    std::condition_variable written_;
+    std::thread thread_;
+};
+
+// --------------------------------------------------------
+
+OutputBuffer::OutputBuffer() = default;
+
+OutputBuffer::~OutputBuffer() {
+    close();
+}
+
+bool OutputBuffer::open(const std::string &path) {
+    close();
+    error_ = 0;
+    if (path == "-") {
+        fd_ = STDOUT_FILENO;
+        owns_fd_ = false;
+    } else {
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        owns_fd_ = true;
+    }
+    buffer_.reserve(BLOCK_SIZE);
+    return fd_ >= 0;
+}
+
+void OutputBuffer::openString(std::string &target) {
+    close();
+    error_ = 0;
+    target_ = &target;
+}
+
+void OutputBuffer::writeInBackground() {
+    if (fd_ >= 0 && writer_ == nullptr) writer_ = std::make_unique<BackgroundWriter>(fd_);
+}
+
+bool OutputBuffer::close() {
+    if (!is_open()) return error_ == 0;
+    flush();
+    if (writer_ != nullptr) {
+        // waits for the last buffer
+        const int error = writer_->finish();
+        if (error_ == 0) error_ = error;
+        writer_.reset();
+    }
+    if (owns_fd_ && ::close(fd_) != 0 && error_ == 0) error_ = errno;
+    fd_ = -1;
+    owns_fd_ = false;
+    target_ = nullptr;
+    return error_ == 0;
+}
+
+void OutputBuffer::flush() {
+    if (target_ != nullptr) {
+        target_->append(buffer_);
+    } else if (writer_ != nullptr) {
+        // the buffer written before comes back to be filled again
+        writer_->submit(buffer_);
+    } else if (error_ == 0) {
+        error_ = writeAll(fd_, buffer_.data(), buffer_.size());
+    }
+    buffer_.clear();
+}
+
+// --------------------------------------------------------
+
+void OutputBuffer::hex8(uint32_t value) {
+    char digits[8];
+    for (int i = 0; i < 4; ++i) {
+        const char *pair = HEX_PAIRS.digits[(value >> (24 - 8 * i)) & 0xFF];
+        digits[2 * i] = pair[0];
+        digits[2 * i + 1] = pair[1];
+    }
+    write({digits, sizeof(digits)});
+}
+
+// --------------------------------------------------------
+
+void OutputBuffer::decimal(int64_t value) {
+    char digits[20];
+    char *begin = digits + sizeof(digits);
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : value;
+    do {
+        *--begin = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) put('-');
+    write(std::string_view(begin, digits + sizeof(digits) - begin));
+}
+
+// --------------------------------------------------------
+
+std::string OutputBuffer::integerString(uint64_t value) const {
+    char digits[20];
+    char *begin = digits + sizeof(digits);
+    do {
+        *--begin = "0123456789abcdef"[value % integer_base_];
+        value /= integer_base_;
+    } while (value != 0);
+    return std::string(begin, digits + sizeof(digits));
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Writes s directly after the buffered data, large images don't need
+ * to be copied into the buffer first.
+ */
+void OutputBuffer::writeLarge(std::string_view s) {
+    flush();
+    if (writer_ != nullptr) {
+        // s may be gone once this returns, it goes through the buffers
+        for (size_t i = 0; i < s.size(); i += BLOCK_SIZE) {
+            buffer_.append(s.substr(i, BLOCK_SIZE));
+            flush();
+        }
+        return;
+    }
+    if (target_ != nullptr) {
+        target_->append(s);
+    } else if (error_ == 0) {
+        error_ = writeAll(fd_, s.data(), s.size());
+    }
+}
+
+// --------------------------------------------------------
+
+InstructionOutput::InstructionOutput(OutputBuffer &stream, int format, bool big_endian)
+    : stream_(&stream)
+    , format_(format)
+    , big_endian_(big_endian) {}
+
+InstructionOutput::InstructionOutput(std::vector<uint32_t> &words)
+    : words_(&words) {}
+
+void InstructionOutput::finish() {
+    if (stream_ == nullptr || format_ != OUTPUT_FORMAT_BIN) return;
+
+    std::string image(image_words_.size() * 4, '\0');
+    char *byte = image.data();
+    for (const uint32_t word: image_words_) {
+        for (int i = 0; i < 4; ++i) {
+            const int shift = big_endian_ ? 24 - 8 * i : 8 * i;
+            *byte++ = static_cast<char>((word >> shift) & 0xFF);
+        }
+    }
+    stream_->write(image);
+    image_words_.clear();
+}
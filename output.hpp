@@ -0,0 +1,196 @@
+#ifndef MIPS_OUTPUT_H
+#define MIPS_OUTPUT_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class BackgroundWriter;
+
+/**
+ * @brief Output file with its own buffer. Text is rendered straight into the
+ * buffer, which is written in large blocks. Replaces the std::ofstream
+ * formatting (std::hex, std::setw, std::setfill) on the hot path.
+ */
+class OutputBuffer {
+public:
+    static constexpr size_t BLOCK_SIZE = 1 << 18;
+
+    OutputBuffer();
+    ~OutputBuffer();
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+    /**
+     * @brief Creates or truncates the file.
+     *
+     * @param path path of the file, "-" writes to stdout
+     * @return bool true if the file could be opened
+     */
+    bool open(const std::string &path);
+
+    /**
+     * @brief Collects everything written in target instead of a file.
+     */
+    void openString(std::string &target);
+    bool is_open() const { return fd_ >= 0 || target_ != nullptr; }
+
+    // errno of the first write that failed, 0 if none did; writes in the
+    // background are only known after close()
+    int error() const { return error_; }
+
+    /**
+     * @brief Writes full buffers on a thread of its own from now on. While
+     * the thread writes one buffer the next one is filled, rendering only
+     * waits if the file can't keep up with it.
+     */
+    void writeInBackground();
+
+    /**
+     * @brief Writes the buffer and closes the file.
+     *
+     * @return bool false if a write failed since the file was opened, see
+     * error()
+     */
+    bool close();
+    void flush();
+
+    void write(std::string_view s) {
+        if (s.size() >= BLOCK_SIZE) {
+            writeLarge(s);
+            return;
+        }
+        buffer_.append(s.data(), s.size());
+        if (buffer_.size() >= BLOCK_SIZE) flush();
+    }
+
+    void put(char c) {
+        buffer_.push_back(c);
+        if (buffer_.size() >= BLOCK_SIZE) flush();
+    }
+
+    /**
+     * @brief Writes count copies of c.
+     */
+    void fill(char c, size_t count) {
+        buffer_.append(count, c);
+        if (buffer_.size() >= BLOCK_SIZE) flush();
+    }
+
+    /**
+     * @brief Writes s left aligned in a field of the given width (like
+     * std::left with std::setw and a ' ' fill).
+     */
+    void padded(std::string_view s, size_t width) {
+        write(s);
+        if (s.size() < width) fill(' ', width - s.size());
+    }
+
+    /**
+     * @brief Writes value as eight lowercase hex digits with leading zeros.
+     */
+    void hex8(uint32_t value);
+
+    /**
+     * @brief Writes value in decimal with a '-' if it is negative, like
+     * std::to_string. Unlike operator<< it ignores the integer base.
+     */
+    void decimal(int64_t value);
+
+    /**
+     * @brief Base for integers written with operator<<. The listing used to
+     * leave std::hex set on its stream after the first instruction line, so
+     * error messages printed later show numbers in hex.
+     */
+    void setIntegerBase(int base) { integer_base_ = base; }
+
+    /**
+     * @brief value as it would be written with operator<<.
+     */
+    std::string integerString(uint64_t value) const;
+
+    OutputBuffer &operator<<(std::string_view s) {
+        write(s);
+        return *this;
+    }
+
+    OutputBuffer &operator<<(uint64_t value) {
+        write(integerString(value));
+        return *this;
+    }
+
+private:
+    void writeLarge(std::string_view s);
+
+    int fd_ = -1;
+    int error_ = 0;  // errno of the first failed write, nothing is written after it
+    bool owns_fd_ = false;
+    std::string *target_ = nullptr;
+    int integer_base_ = 10;
+    std::string buffer_;
+    std::unique_ptr<BackgroundWriter> writer_;  // nullptr while writing in place
+};
+
+// --------------------------------------------------------
+
+// formats of the instruction output
+enum {
+    OUTPUT_FORMAT_HEX,  // one "0x%08x" line per instruction
+    OUTPUT_FORMAT_BIN   // flat binary image, four bytes per instruction
+};
+
+/**
+ * @brief Destination of the encoded instructions. In OUTPUT_FORMAT_HEX every
+ * word is written right away, in OUTPUT_FORMAT_BIN the words are collected
+ * and written as one image by finish().
+ */
+class InstructionOutput {
+public:
+    /**
+     * @param stream output file for the instructions
+     * @param format OUTPUT_FORMAT_HEX or OUTPUT_FORMAT_BIN
+     * @param big_endian byte order of the words in the binary image
+     */
+    InstructionOutput(OutputBuffer &stream, int format, bool big_endian);
+
+    /**
+     * @brief Only collects the words in memory.
+     *
+     * @param words receives the encoded instructions
+     */
+    explicit InstructionOutput(std::vector<uint32_t> &words);
+
+    InstructionOutput(const InstructionOutput &) = delete;
+    InstructionOutput &operator=(const InstructionOutput &) = delete;
+
+    void add(uint32_t binary_instruction) {
+        ++count_;
+        if (stream_ != nullptr && format_ == OUTPUT_FORMAT_HEX) {
+            stream_->write("0x");
+            stream_->hex8(binary_instruction);
+            stream_->put('\n');
+            return;
+        }
+        words_->push_back(binary_instruction);
+    }
+
+    /**
+     * @brief Writes the binary image, does nothing in OUTPUT_FORMAT_HEX.
+     */
+    void finish();
+
+    // instructions added so far
+    size_t count() const { return count_; }
+
+private:
+    OutputBuffer *stream_ = nullptr;
+    int format_ = OUTPUT_FORMAT_BIN;
+    bool big_endian_ = true;
+    std::vector<uint32_t> *words_ = &image_words_;
+    std::vector<uint32_t> image_words_;  // words of the binary image
+    size_t count_ = 0;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef MIPS_PASSES_H
+#define MIPS_PASSES_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "assembler.hpp"
+#include "definitions.hpp"
+#include "instruction.hpp"
+#include "output.hpp"
+#include "program.hpp"
+#include "symbols.hpp"
+
+// The single steps of assemble(), documented in assembler.cpp. They are not
+// part of the library interface, mips-bench times them one by one and the
+// incremental mode reuses them for the lines that changed.
+
+void defineLabel(SymbolTable &symbols,
+                 std::string_view label,
+                 uint32_t hash,
+                 int address,
+                 size_t line,
+                 std::vector<Diagnostic> &warnings);
+
+void firstPass(std::string_view source, SymbolTable &symbols, std::vector<Diagnostic> &warnings);
+
+void secondPass(std::string_view source,
+                OutputBuffer &outputListing,
+                InstructionOutput &outputInstructions,
+                SymbolTable &symbols,
+                bool listing);
+
+uint32_t regCode(std::string_view s, const RegisterCode &code, OutputBuffer &errout);
+
+uint32_t binInstruction(const Instruction &instruction, OutputBuffer &errout);
+
+void resolveLabel(Instruction &instruction, int labelAddr, int instruction_count);
+
+void outputPrinting(OutputBuffer &outputListing,
+            InstructionOutput &outputInstructions,
+            const Instruction &instruction,
+            std::string_view comment,
+            std::string_view label,
+            int &instruction_count,
+            bool labelSingle);
+
+void outputInstruction(OutputBuffer &errout,
+                       InstructionOutput &outputInstructions,
+                       const Instruction &instruction,
+                       int &instruction_count,
+                       bool labelSingle);
+
+size_t resolveProgramLabels(Program &program, const SymbolTable &symbols);
+
+void encodeLines(std::string_view text,
+                 size_t first_line,
+                 int instruction_count,
+                 OutputBuffer &outputListing,
+                 InstructionOutput &outputInstructions,
+                 const SymbolTable &symbols,
+                 bool listing,
+                 bool wall = true);
+
+size_t encodeProgram(Program &program);
+
+void listProgram(const Program &program, size_t end_line, OutputBuffer &outputListing);
+
+void symbolsOutputPrinting(OutputBuffer &outputListing, SymbolTable &symbols);
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef MIPS_PERFECT_HASH_H
+#define MIPS_PERFECT_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief Seeded FNV-1a hash of a string.
+ */
+constexpr uint32_t seededHash(std::string_view s, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (const char c: s) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Number of slots for n keys: a power of two of about n^2 / 2, so a
+ * seed without collisions is found after a couple of tries.
+ */
+constexpr size_t perfectHashSize(size_t n) {
+    size_t size = 16;
+    while (size < n * n / 2) size *= 2;
+    return size;
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Hash table over a fixed set of named entries that is built entirely
+ * at compile time. The constructor searches a seed until every name gets a
+ * slot of its own, so a lookup is one hash, one load and one compare.
+ *
+ * @tparam Entry type with a std::string_view member "name"
+ * @tparam N number of entries
+ */
+template <typename Entry, size_t N>
+class PerfectHash {
+public:
+    static_assert(N < 0xFF, "slots store the entry index in one byte");
+    static constexpr size_t SIZE = perfectHashSize(N);
+    static constexpr uint32_t MAX_SEED = 1u << 16;
+
+    constexpr explicit PerfectHash(const Entry (&entries)[N]) : entries_(entries) {
+        while (seed_ < MAX_SEED && !trySeed()) ++seed_;
+    }
+
+    /**
+     * @brief false if no seed without collisions was found (e.g. because a
+     * name occurs twice), check it with a static_assert.
+     */
+    constexpr bool valid() const { return seed_ < MAX_SEED; }
+
+    /**
+     * @brief Looks up an entry by its name.
+     *
+     * @return const Entry* the entry, nullptr if there is none with that name
+     */
+    constexpr const Entry *find(std::string_view name) const {
+        const uint8_t index = slots_[seededHash(name, seed_) & (SIZE - 1)];
+        if (index == EMPTY || entries_[index].name != name) return nullptr;
+        return &entries_[index];
+    }
+
+private:
+    static constexpr uint8_t EMPTY = 0xFF;
+
+    constexpr bool trySeed() {
+        for (auto &slot: slots_) slot = EMPTY;
+        for (size_t i = 0; i < N; ++i) {
+            uint8_t &slot = slots_[seededHash(entries_[i].name, seed_) & (SIZE - 1)];
+            if (slot != EMPTY) return false;
+            slot = static_cast<uint8_t>(i);
+        }
+        return true;
+    }
+
+    const Entry *entries_;
+    uint32_t seed_ = 0;
+    uint8_t slots_[SIZE] = {};
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "program.hpp"
+
+#include <algorithm>
+
+#include "definitions.hpp"
+#include "instruction.hpp"
+#include "lexer.hpp"
+#include "source.hpp"
+
+namespace {
+
+uint8_t registerField(const Instruction &instruction, size_t part) {
+    const RegisterCode &code = instruction.registers[part];
+    return code.status == REGISTER_OK ? static_cast<uint8_t>(code.number) : REGISTER_NONE;
+}
+
+/**
+ * @brief Appends a parsed instruction to the instruction arrays. The register
+ * fields are filled the way the format of the instruction encodes them.
+ */
+void addInstruction(Program &program, const Instruction &instruction, size_t line, int address) {
+    const size_t i = program.instruction_count++;
+    const size_t count = instruction.part_count;
+    if (instruction.exit) {
+        program.opcode[i] = OPCODE_EXIT;
+    } else if (instruction.entry == nullptr) {
+        program.opcode[i] = OPCODE_UNKNOWN;
+    } else {
+        program.opcode[i] = static_cast<uint8_t>(instruction.entry - INSTR_CODES);
+    }
+    program.part_count[i] = static_cast<uint8_t>(count);
+    program.flags[i] = (instruction.immediate_valid ? INSTRUCTION_NUMBER_VALID : 0) |
+                       (instruction.number_part != 0 ? INSTRUCTION_NUMBER_LISTED : 0) |
+                       (!instruction.jump_label.empty() ? INSTRUCTION_JUMPS_TO_LABEL : 0);
+
+    uint8_t rs = 0, rt = 0, rd = 0;
+    const int format = instruction.entry == nullptr ? static_cast<int>(INSTR_TYPE_NULL)
+                                                      : static_cast<int>(instruction.entry->codes.format);
+    if (format == INSTR_TYPE_R && count == 2) {
+        rs = registerField(instruction, 1);
+    } else if (format == INSTR_TYPE_R && count == 4) {
+        rs = registerField(instruction, 2);
+        rt = registerField(instruction, 3);
+        rd = registerField(instruction, 1);
+    } else if (format == INSTR_TYPE_R_SHIFT && count == 4) {
+        rt = registerField(instruction, 2);
+        rd = registerField(instruction, 1);
+    } else if (format == INSTR_TYPE_I && count == 4) {
+        rs = registerField(instruction, 2);
+        rt = registerField(instruction, 1);
+    }
+    program.rs[i] = rs;
+    program.rt[i] = rt;
+    program.rd[i] = rd;
+
+    program.immediate[i] = instruction.immediate;
+    program.address[i] = address;
+    program.line[i] = static_cast<uint32_t>(line);
+    program.word[i] = 0;
+    program.jump_hash[i] = instruction.jump_hash;
+    std::copy(instruction.parts, instruction.parts + 4, program.parts + 4 * i);
+}
+
+}  // namespace
+
+// --------------------------------------------------------
+
+size_t buildProgram(Program &program, Arena &arena, std::string_view text, int first_address, bool listing) {
+    size_t capacity = std::count(text.begin(), text.end(), '\n');
+    if (!text.empty() && text.back() != '\n') ++capacity;
+
+    program = Program();
+    program.text = text;
+    program.line_offset = arena.allocate<size_t>(capacity);
+    program.line_kind = arena.allocate<uint8_t>(capacity);
+    if (listing) {
+        program.label = arena.allocate<std::string_view>(capacity);
+        program.comment = arena.allocate<std::string_view>(capacity);
+    }
+    program.opcode = arena.allocate<uint8_t>(capacity);
+    program.part_count = arena.allocate<uint8_t>(capacity);
+    program.flags = arena.allocate<uint8_t>(capacity);
+    program.rs = arena.allocate<uint8_t>(capacity);
+    program.rt = arena.allocate<uint8_t>(capacity);
+    program.rd = arena.allocate<uint8_t>(capacity);
+    program.immediate = arena.allocate<int32_t>(capacity);
+    program.address = arena.allocate<int32_t>(capacity);
+    program.line = arena.allocate<uint32_t>(capacity);
+    program.word = arena.allocate<uint32_t>(capacity);
+    program.parts = arena.allocate<std::string_view>(4 * capacity);
+    program.jump_hash = arena.allocate<uint32_t>(capacity);
+
+    LineReader fileReader(text);
+    std::string_view currentLine;
+    Instruction instruction;
+    int address = first_address;
+    while (fileReader.next(currentLine)) {
+        const size_t i = program.line_count++;
+        const LineTokens tokens = lexLine(currentLine, listing);
+        program.line_offset[i] = currentLine.data() - text.data();
+        if (listing) {
+            program.label[i] = tokens.label;
+            program.comment[i] = tokens.comment;
+        }
+
+        if (!parseInstruction(tokens, instruction)) {
+            program.line_kind[i] = PROGRAM_LINE_TOO_LONG;
+        } else if (instruction.kind == INSTRUCTION_INVALID) {
+            program.line_kind[i] = PROGRAM_LINE_INVALID;
+        } else if (instruction.kind == INSTRUCTION_NONE) {
+            program.line_kind[i] = PROGRAM_LINE_EMPTY;
+            continue;
+        } else {
+            program.line_kind[i] = PROGRAM_LINE_INSTRUCTION;
+            addInstruction(program, instruction, i, address);
+            if (!tokens.label_single) address += 4;
+            continue;
+        }
+        // the assembly stops here, nothing behind this line is needed
+        return i;
+    }
+    return program.line_count;
+}
+
+// --------------------------------------------------------
+
+std::string_view programLine(const Program &program, size_t i) {
+    std::string_view line = program.text.substr(program.line_offset[i]);
+    return line.substr(0, line.find('\n'));
+}
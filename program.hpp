@@ -0,0 +1,82 @@
+#ifndef MIPS_PROGRAM_H
+#define MIPS_PROGRAM_H
+
+#include <cstdint>
+#include <string_view>
+
+#include "arena.hpp"
+
+// what a line of a Program holds
+enum {
+    PROGRAM_LINE_EMPTY,        // label and comment only
+    PROGRAM_LINE_INSTRUCTION,  // one instruction
+    PROGRAM_LINE_INVALID,      // code that fits no instruction layout
+    PROGRAM_LINE_TOO_LONG      // "beq" with an offset that is too long
+};
+
+// opcodes that are no index into INSTR_CODES
+constexpr uint8_t OPCODE_EXIT = 0xFE;
+constexpr uint8_t OPCODE_UNKNOWN = 0xFF;
+
+// register fields that name no valid register
+constexpr uint8_t REGISTER_NONE = 0xFF;
+
+// flags of an instruction
+enum {
+    INSTRUCTION_NUMBER_VALID = 1 << 0,  // immediate holds a valid number
+    INSTRUCTION_NUMBER_LISTED = 1 << 1, // the listing shows the immediate instead of its text
+    INSTRUCTION_JUMPS_TO_LABEL = 1 << 2,// a "j" or "beq" that names a label
+    INSTRUCTION_FAILS = 1 << 3          // can't be encoded or its label doesn't exist
+};
+
+/**
+ * @brief A source in struct-of-arrays form: parallel arrays with one entry per
+ * line and parallel arrays with one entry per instruction, all allocated from
+ * an arena. Resolving labels, encoding and listing are loops over the arrays.
+ */
+struct Program {
+    std::string_view text;
+    size_t line_count = 0;
+    size_t instruction_count = 0;
+
+    // one entry per line
+    size_t *line_offset = nullptr;  // start of the line in text
+    uint8_t *line_kind = nullptr;   // PROGRAM_LINE_*
+    std::string_view *label = nullptr;    // nullptr without listing
+    std::string_view *comment = nullptr;  // nullptr without listing
+
+    // one entry per instruction
+    uint8_t *opcode = nullptr;      // index into INSTR_CODES or OPCODE_*
+    uint8_t *part_count = nullptr;  // mnemonic and operands: 1, 2 or 4
+    uint8_t *flags = nullptr;       // INSTRUCTION_*
+    uint8_t *rs = nullptr;
+    uint8_t *rt = nullptr;
+    uint8_t *rd = nullptr;
+    int32_t *immediate = nullptr;   // shift amount, immediate, offset or jump target
+    int32_t *address = nullptr;
+    uint32_t *line = nullptr;       // line of the instruction
+    uint32_t *word = nullptr;       // the encoded instruction
+    std::string_view *parts = nullptr;  // four per instruction, as written
+    uint32_t *jump_hash = nullptr;  // labelHash of the label a "j" or "beq" jumps to
+};
+
+/**
+ * @brief Reads every line of text into program. Registers and numbers are
+ * decoded on the way, labels are resolved and instructions encoded later.
+ *
+ * @param program receives the lines and instructions
+ * @param arena memory of the arrays, has to outlive program
+ * @param text the source lines
+ * @param first_address address of the first instruction in text
+ * @param listing false skips labels and comments, which only the listing needs
+ * @return size_t index of the first line that is invalid or too long,
+ * program.line_count if there is none
+ */
+size_t buildProgram(Program &program, Arena &arena, std::string_view text, int first_address, bool listing);
+
+/**
+ * @brief Line number i of the program without its line break.
+ */
+std::string_view programLine(const Program &program, size_t i);
+
+#endif
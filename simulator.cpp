@@ -0,0 +1,490 @@
+#include "simulator.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <limits>
+
+#include "definitions.hpp"
+#include "output.hpp"
+
+namespace {
+
+// operations of micro-ops, the order of HANDLERS in run()
+enum {
+    OP_ADD,
+    OP_SUB,
+    OP_AND,
+    OP_OR,
+    OP_NOR,
+    OP_SLT,
+    OP_LW,
+    OP_SW,
+    OP_BEQ,
+    OP_ADDI,
+    OP_SLL,
+    OP_J,
+    OP_JR,
+    OP_NOP,
+    OP_EXIT,
+    OP_INVALID,       // a word that is no supported instruction
+    OP_BEQ_OUTSIDE,   // "beq" whose target is outside the program
+    OP_J_OUTSIDE,     // "j" whose target is outside the program
+    OP_END,           // the word past the last one
+    OP_ADD_BEQ,       // superinstructions, two instructions in one micro-op
+    OP_ADDI_BEQ,
+    OP_ADD_LW,
+    OP_ADD_SW,
+    OP_COUNT
+};
+
+// micro-ops the block cache holds per program word, when it is full it is
+// emptied
+constexpr size_t CACHE_BLOCKS = 4;
+
+/**
+ * @brief Whether a micro-op is the last one of its block.
+ */
+constexpr bool endsBlock(uint8_t op) {
+    switch (op) {
+        case OP_BEQ:
+        case OP_J:
+        case OP_JR:
+        case OP_EXIT:
+        case OP_INVALID:
+        case OP_BEQ_OUTSIDE:
+        case OP_J_OUTSIDE:
+        case OP_END:
+        case OP_ADD_BEQ:
+        case OP_ADDI_BEQ:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Whether a micro-op ends in a "beq", which goes on behind it when it
+ * isn't taken.
+ */
+constexpr bool branches(uint8_t op) {
+    return op == OP_BEQ || op == OP_BEQ_OUTSIDE || op == OP_ADD_BEQ || op == OP_ADDI_BEQ;
+}
+
+/**
+ * @brief The superinstruction of two instructions in a row, OP_COUNT if
+ * there is none. The pair runs in order, so the fused instructions needn't
+ * depend on each other; in the loops they are made for the "add" or "addi"
+ * updates what the "beq" compares and the "add" computes the address of the
+ * "lw" or "sw".
+ */
+constexpr uint8_t fusedOperation(uint8_t first, uint8_t second) {
+    if (first == OP_ADD && second == OP_BEQ) return OP_ADD_BEQ;
+    if (first == OP_ADDI && second == OP_BEQ) return OP_ADDI_BEQ;
+    if (first == OP_ADD && second == OP_LW) return OP_ADD_LW;
+    if (first == OP_ADD && second == OP_SW) return OP_ADD_SW;
+    return OP_COUNT;
+}
+
+struct Operation {
+    std::string_view name;
+    uint8_t op;
+};
+
+// operation of every mnemonic in INSTR_CODES
+constexpr Operation OPERATIONS[] = {
+    {"add", OP_ADD}, {"sub", OP_SUB},   {"and", OP_AND},   {"or", OP_OR}, {"nor", OP_NOR},
+    {"slt", OP_SLT}, {"lw", OP_LW},     {"sw", OP_SW},     {"beq", OP_BEQ}, {"addi", OP_ADDI},
+    {"sll", OP_SLL}, {"j", OP_J},       {"jr", OP_JR},     {"nop", OP_NOP}};
+
+static_assert(std::size(OPERATIONS) == std::size(INSTR_CODES), "every instruction of INSTR_CODES needs an operation");
+
+// operation for every op code and, for op code 0, every function code
+constexpr struct DecodeTable {
+    uint8_t by_op_code[64] = {};
+    uint8_t by_function[64] = {};
+
+    constexpr DecodeTable() {
+        for (auto &op: by_op_code) op = OP_INVALID;
+        for (auto &op: by_function) op = OP_INVALID;
+        for (const auto &operation: OPERATIONS) {
+            const InstructionCodes codes = INSTR_TABLE.find(operation.name)->codes;
+            if (codes.format == INSTR_TYPE_R || codes.format == INSTR_TYPE_R_SHIFT) {
+                by_function[codes.function] = operation.op;
+            } else if (codes.format != INSTR_TYPE_NULL) {
+                by_op_code[codes.op_code] = operation.op;
+            }
+        }
+    }
+
+    constexpr uint8_t operation(uint32_t word) const {
+        if (word == ~0u) return OP_EXIT;
+        if (word == 0) return OP_NOP;
+        const uint32_t op_code = word >> 26;
+        return op_code == 0 ? by_function[word & 0x3F] : by_op_code[op_code];
+    }
+} DECODE_TABLE;
+
+static_assert(DECODE_TABLE.operation(0x014B4820) == OP_ADD && DECODE_TABLE.operation(0x08000004) == OP_J);
+
+/**
+ * @brief Reads one "0x%08x" line.
+ */
+bool parseHexWord(std::string_view line, uint32_t &word) {
+    if (line.size() != 10 || line[0] != '0' || (line[1] != 'x' && line[1] != 'X')) return false;
+    word = 0;
+    for (const char c: line.substr(2)) {
+        uint32_t digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        word = word << 4 | digit;
+    }
+    return true;
+}
+
+std::string hexWord(uint32_t word) {
+    char text[11];
+    std::snprintf(text, sizeof(text), "0x%08x", word);
+    return text;
+}
+
+}  // namespace
+
+// --------------------------------------------------------
+
+bool loadImage(std::string_view contents, int format, bool big_endian, std::vector<uint32_t> &words) {
+    if (format == OUTPUT_FORMAT_BIN) {
+        words.reserve(contents.size() / 4);
+        for (size_t i = 0; i + 4 <= contents.size(); i += 4) {
+            uint32_t word = 0;
+            for (int j = 0; j < 4; ++j) {
+                const int shift = big_endian ? 24 - 8 * j : 8 * j;
+                word |= static_cast<uint32_t>(static_cast<unsigned char>(contents[i + j])) << shift;
+            }
+            words.push_back(word);
+        }
+        return contents.size() % 4 == 0;
+    }
+
+    words.reserve(contents.size() / 11);
+    while (!contents.empty()) {
+        const size_t end = contents.find('\n');
+        const std::string_view line = contents.substr(0, end);
+        contents.remove_prefix(end == std::string_view::npos ? contents.size() : end + 1);
+        uint32_t word;
+        if (!parseHexWord(line, word)) return false;
+        words.push_back(word);
+    }
+    return true;
+}
+
+// --------------------------------------------------------
+
+Simulator::Simulator(const std::vector<uint32_t> &program, size_t memory_bytes)
+    : memory_(program)
+    , program_words_(program.size())
+    , blocks_(program.size() + 1, nullptr) {
+    memory_.resize(std::max(program.size(), (memory_bytes + 3) / 4));
+    ops_.reserve(CACHE_BLOCKS * (program_words_ + 1));
+}
+
+/**
+ * @brief Decodes the word at index, the word past the program is OP_END.
+ * Operands that aren't used by the operation are decoded anyway, they are
+ * never read.
+ */
+Simulator::MicroOp Simulator::decode(size_t index) const {
+    MicroOp decoded;
+    decoded.index = static_cast<uint32_t>(index);
+    if (index == program_words_) {
+        decoded.op = OP_END;
+        return decoded;
+    }
+    const uint32_t word = memory_[index];
+    decoded.op = DECODE_TABLE.operation(word);
+    decoded.rs = (word >> 21) & 0x1F;
+    decoded.rt = (word >> 16) & 0x1F;
+    decoded.rd = (word >> 11) & 0x1F;
+    decoded.imm = static_cast<int16_t>(word & 0xFFFF);
+
+    switch (decoded.op) {
+        case OP_SLL:
+            decoded.imm = (word >> 6) & 0x1F;
+            break;
+        case OP_LW:
+        case OP_ADDI:
+            // the destination of the I type is rt
+            decoded.rd = decoded.rt;
+            break;
+        case OP_BEQ: {
+            const int64_t target = static_cast<int64_t>(index) + 1 + decoded.imm;
+            if (target < 0 || target > static_cast<int64_t>(program_words_)) {
+                decoded.op = OP_BEQ_OUTSIDE;
+            } else {
+                decoded.target = static_cast<uint32_t>(target);
+            }
+            break;
+        }
+        case OP_J:
+            decoded.target = word & 0x3FFFFFF;
+            if (decoded.target > program_words_) decoded.op = OP_J_OUTSIDE;
+            break;
+        default:
+            break;
+    }
+    if (decoded.rd == 0) decoded.rd = SINK;
+    return decoded;
+}
+
+/**
+ * @brief Translates the block that starts at the word index into ops_,
+ * which must have room for the words up to the end of the program.
+ *
+ * @param handlers the code of every operation
+ * @return MicroOp* the first micro-op of the block
+ */
+Simulator::MicroOp *Simulator::translate(size_t index, const void *const *handlers) {
+    MicroOp *const first = ops_.data() + ops_.size();
+    blocks_[index] = first;
+    uint32_t count = 0;
+    while (true) {
+        MicroOp op = decode(index);
+        op.count = count;
+        size_t size = 1;
+        if (!endsBlock(op.op)) {
+            const MicroOp second = decode(index + 1);
+            const uint8_t fused = fusedOperation(op.op, second.op);
+            if (fused != OP_COUNT) {
+                op.op = fused;
+                op.rd2 = second.rd;
+                op.rs2 = second.rs;
+                op.rt2 = second.rt;
+                op.imm2 = second.imm;
+                op.target = second.target;
+                size = 2;
+            }
+        }
+        if (branches(op.op)) {
+            // the loop shape "beq" out, "j" back goes on at the "j" target
+            const MicroOp behind = decode(index + size);
+            op.follow = behind.op == OP_J ? behind.target : static_cast<uint32_t>(index + size);
+            op.follow_size = static_cast<uint8_t>(behind.op == OP_J ? size + 1 : size);
+        }
+        op.handler = handlers[op.op];
+        ops_.push_back(op);
+        if (endsBlock(op.op)) return first;
+        count += size;
+        index += size;
+    }
+}
+
+/**
+ * @brief Forgets every translated block, after the program changed.
+ */
+void Simulator::flush() {
+    ops_.clear();
+    std::fill(blocks_.begin(), blocks_.end(), nullptr);
+}
+
+// --------------------------------------------------------
+
+SimulationResult Simulator::run(uint64_t max_instructions) {
+    // code of every operation, in the order of OP_*
+    static const void *const HANDLERS[] = {
+        &&op_add, &&op_sub, &&op_and, &&op_or, &&op_nor, &&op_slt, &&op_lw, &&op_sw, &&op_beq, &&op_addi,
+        &&op_sll, &&op_j, &&op_jr, &&op_nop, &&op_exit, &&op_invalid, &&op_beq_outside, &&op_j_outside, &&op_end,
+        &&op_add_beq, &&op_addi_beq, &&op_add_lw, &&op_add_sw};
+    static_assert(std::size(HANDLERS) == OP_COUNT, "every operation needs a handler");
+
+    SimulationResult result;
+    const uint64_t limit = max_instructions == 0 ? std::numeric_limits<uint64_t>::max() : max_instructions;
+    uint64_t executed = 0;
+    int32_t *const r = registers_;
+    uint32_t *const memory = memory_.data();
+    const size_t memory_words = memory_.size();
+    MicroOp *op = nullptr;
+    uint32_t next = pc_ / 4;    // word the next block starts at, or where run stopped
+    MicroOp **chain = nullptr;  // link of the exit that leads to next, nullptr if it isn't chained
+    uint32_t address = 0;
+    int32_t value = 0;
+
+// runs the next micro-op of the block
+#define NEXT()              \
+    do {                    \
+        ++op;               \
+        goto *op->handler;  \
+    } while (0)
+
+// leaves the block after size instructions of op to the block at word,
+// through link once it is chained
+#define LEAVE(size, word, link)               \
+    do {                                      \
+        executed += op->count + (size);       \
+        if (executed >= limit) {              \
+            next = (word);                    \
+            goto stop;                        \
+        }                                     \
+        if (op->link != nullptr) {            \
+            op = op->link;                    \
+            goto *op->handler;                \
+        }                                     \
+        next = (word);                        \
+        chain = &op->link;                    \
+        goto dispatch;                        \
+    } while (0)
+
+// stops in front of the instruction offset of op
+#define FAULT(offset, message)             \
+    do {                                   \
+        executed += op->count + (offset);  \
+        next = op->index + (offset);       \
+        result.fault = message;            \
+        goto fault;                        \
+    } while (0)
+
+// a sw wrote into the program, the blocks are translated again
+#define STORED(size, word)                  \
+    do {                                    \
+        if ((word) < program_words_) {      \
+            executed += op->count + (size); \
+            next = op->index + (size);      \
+            flush();                        \
+            chain = nullptr;                \
+            goto dispatch;                  \
+        }                                   \
+    } while (0)
+
+dispatch:
+    op = blocks_[next];
+    if (op == nullptr) {
+        if (ops_.size() + (program_words_ + 1 - next) > ops_.capacity()) {
+            // the cache is full, blocks are never moved
+            flush();
+            chain = nullptr;
+        }
+        op = translate(next, HANDLERS);
+    }
+    if (chain != nullptr) *chain = op;
+    goto *op->handler;
+
+op_add:
+    if (__builtin_add_overflow(r[op->rs], r[op->rt], &value)) FAULT(0, "arithmetic overflow");
+    r[op->rd] = value;
+    NEXT();
+op_sub:
+    if (__builtin_sub_overflow(r[op->rs], r[op->rt], &value)) FAULT(0, "arithmetic overflow");
+    r[op->rd] = value;
+    NEXT();
+op_and:
+    r[op->rd] = r[op->rs] & r[op->rt];
+    NEXT();
+op_or:
+    r[op->rd] = r[op->rs] | r[op->rt];
+    NEXT();
+op_nor:
+    r[op->rd] = ~(r[op->rs] | r[op->rt]);
+    NEXT();
+op_slt:
+    r[op->rd] = r[op->rs] < r[op->rt];
+    NEXT();
+op_lw:
+    address = static_cast<uint32_t>(r[op->rs]) + static_cast<uint32_t>(op->imm);
+    if ((address & 3) != 0 || address / 4 >= memory_words) FAULT(0, "lw from " + hexWord(address));
+    r[op->rd] = static_cast<int32_t>(memory[address / 4]);
+    NEXT();
+op_sw:
+    address = static_cast<uint32_t>(r[op->rs]) + static_cast<uint32_t>(op->imm);
+    if ((address & 3) != 0 || address / 4 >= memory_words) FAULT(0, "sw to " + hexWord(address));
+    memory[address / 4] = static_cast<uint32_t>(r[op->rt]);
+    STORED(1, address / 4);
+    NEXT();
+op_beq:
+    if (r[op->rs] == r[op->rt]) LEAVE(1, op->target, taken);
+    LEAVE(op->follow_size, op->follow, fallthrough);
+op_addi:
+    if (__builtin_add_overflow(r[op->rs], op->imm, &value)) FAULT(0, "arithmetic overflow");
+    r[op->rd] = value;
+    NEXT();
+op_sll:
+    r[op->rd] = static_cast<int32_t>(static_cast<uint32_t>(r[op->rt]) << op->imm);
+    NEXT();
+op_j:
+    LEAVE(1, op->target, taken);
+op_jr:
+    address = static_cast<uint32_t>(r[op->rs]);
+    if ((address & 3) != 0 || address / 4 > program_words_) FAULT(0, "jr to " + hexWord(address));
+    // the target changes, jr isn't chained
+    executed += op->count + 1;
+    next = address / 4;
+    chain = nullptr;
+    if (executed >= limit) goto stop;
+    goto dispatch;
+op_nop:
+    NEXT();
+op_beq_outside:
+    if (r[op->rs] == r[op->rt]) FAULT(0, "beq leaves the program");
+    LEAVE(op->follow_size, op->follow, fallthrough);
+op_j_outside:
+    FAULT(0, "j leaves the program");
+op_invalid:
+    FAULT(0, "unsupported instruction " + hexWord(memory[op->index]));
+
+op_add_beq:
+    if (__builtin_add_overflow(r[op->rs], r[op->rt], &value)) FAULT(0, "arithmetic overflow");
+    r[op->rd] = value;
+    if (r[op->rs2] == r[op->rt2]) LEAVE(2, op->target, taken);
+    LEAVE(op->follow_size, op->follow, fallthrough);
+op_addi_beq:
+    if (__builtin_add_overflow(r[op->rs], op->imm, &value)) FAULT(0, "arithmetic overflow");
+    r[op->rd] = value;
+    if (r[op->rs2] == r[op->rt2]) LEAVE(2, op->target, taken);
+    LEAVE(op->follow_size, op->follow, fallthrough);
+op_add_lw:
+    if (__builtin_add_overflow(r[op->rs], r[op->rt], &value)) FAULT(0, "arithmetic overflow");
+    r[op->rd] = value;
+    address = static_cast<uint32_t>(r[op->rs2]) + static_cast<uint32_t>(op->imm2);
+    if ((address & 3) != 0 || address / 4 >= memory_words) FAULT(1, "lw from " + hexWord(address));
+    r[op->rd2] = static_cast<int32_t>(memory[address / 4]);
+    NEXT();
+op_add_sw:
+    if (__builtin_add_overflow(r[op->rs], r[op->rt], &value)) FAULT(0, "arithmetic overflow");
+    r[op->rd] = value;
+    address = static_cast<uint32_t>(r[op->rs2]) + static_cast<uint32_t>(op->imm2);
+    if ((address & 3) != 0 || address / 4 >= memory_words) FAULT(1, "sw to " + hexWord(address));
+    memory[address / 4] = static_cast<uint32_t>(r[op->rt2]);
+    STORED(2, address / 4);
+    NEXT();
+
+op_exit:
+    executed += op->count;
+    next = op->index;
+    result.status = SIM_HALTED;
+    goto done;
+op_end:
+    executed += op->count;
+    next = op->index;
+    result.status = SIM_END;
+    goto done;
+stop:
+    result.status = SIM_LIMIT;
+    goto done;
+fault:
+    result.status = SIM_FAULT;
+done:
+    registers_[SINK] = 0;
+#undef NEXT
+#undef LEAVE
+#undef FAULT
+#undef STORED
+    pc_ = next * 4;
+    result.pc = pc_;
+    result.instructions = executed;
+    return result;
+}
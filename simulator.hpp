@@ -0,0 +1,119 @@
+#ifndef MIPS_SIMULATOR_H
+#define MIPS_SIMULATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// why Simulator::run stopped
+enum {
+    SIM_HALTED,  // reached the "exit" word 0xFFFFFFFF
+    SIM_END,     // ran past the last word of the program
+    SIM_LIMIT,   // executed max_instructions
+    SIM_FAULT    // unsupported word, bad address, overflow, see fault
+};
+
+struct SimulationResult {
+    int status = SIM_HALTED;
+    uint64_t instructions = 0;  // instructions executed, "exit" not counted
+    uint32_t pc = 0;            // address of the instruction run stopped at
+    std::string fault;          // the reason of SIM_FAULT
+};
+
+/**
+ * @brief Reads an image written by the assembler.
+ *
+ * @param contents the instruction file
+ * @param format OUTPUT_FORMAT_HEX (one "0x%08x" line per word) or
+ * OUTPUT_FORMAT_BIN
+ * @param big_endian byte order of OUTPUT_FORMAT_BIN
+ * @param words receives the words
+ * @return bool false if contents isn't such an image, words holds the words
+ * in front of the problem
+ */
+bool loadImage(std::string_view contents, int format, bool big_endian, std::vector<uint32_t> &words);
+
+/**
+ * @brief Runs an assembled program: the instructions of INSTR_CODES and
+ * "exit", which halts. The image is loaded at address 0 of a word
+ * addressed memory that also holds the data of lw and sw. There are no
+ * branch delay slots, a taken "beq" goes to the address after it plus its
+ * offset, "j" to its target times 4, like the assembler encodes them. "add",
+ * "sub" and "addi" stop with a fault on signed overflow.
+ *
+ * The program is translated a basic block at a time, when the block runs
+ * the first time: the words from a jump target up to the next "beq", "j",
+ * "jr" or "exit" are decoded once into micro-ops, and the block is kept in a
+ * cache by its first word. Common pairs are fused into one micro-op, an
+ * "add" or "addi" followed by a "beq" and the "add" computing the address of
+ * a following "lw" or "sw". Micro-ops are dispatched direct-threaded, each
+ * holds the address of the code that runs it, and a block that ends in "beq"
+ * or "j" is chained to the block it continues with once that one is known; a
+ * "beq" that isn't taken runs a "j" right behind it along with it.
+ * Instructions are counted a block at a time. A "sw" into the program
+ * empties the cache, and so does a block that doesn't fit into it anymore.
+ */
+class Simulator {
+public:
+    /**
+     * @param program the words of the image
+     * @param memory_bytes size of the memory, at least the size of the image
+     */
+    Simulator(const std::vector<uint32_t> &program, size_t memory_bytes);
+
+    // the translated blocks point into each other
+    Simulator(const Simulator &) = delete;
+    Simulator &operator=(const Simulator &) = delete;
+
+    /**
+     * @brief Runs from the current pc until the program stops.
+     *
+     * @param max_instructions 0 for no limit, otherwise run stops at the next
+     * "beq", "j" or "jr" once that many instructions ran
+     */
+    SimulationResult run(uint64_t max_instructions = 0);
+
+    // register values, $zero stays 0
+    int32_t reg(size_t number) const { return registers_[number]; }
+    uint32_t pc() const { return pc_; }
+
+    // register index that writes to $zero go to, it is never read
+    static constexpr uint8_t SINK = 32;
+
+private:
+    // an instruction or a fused pair of a translated block
+    struct MicroOp {
+        const void *handler = nullptr;
+        MicroOp *taken = nullptr;        // the block at target, nullptr until chained
+        MicroOp *fallthrough = nullptr;  // the block behind a "beq", nullptr until chained
+        uint8_t op = 0;
+        uint8_t rd = 0;                  // destination, SINK for $zero
+        uint8_t rs = 0;
+        uint8_t rt = 0;
+        uint8_t rd2 = 0;                 // operands of the second instruction of a pair
+        uint8_t rs2 = 0;
+        uint8_t rt2 = 0;
+        uint8_t follow_size = 0;         // instructions a "beq" that isn't taken runs
+        int32_t imm = 0;                 // sign extended immediate or shift amount
+        int32_t imm2 = 0;
+        uint32_t index = 0;              // word of the (first) instruction
+        uint32_t count = 0;              // instructions of the block in front of this micro-op
+        uint32_t target = 0;             // word a "beq" or "j" goes to
+        uint32_t follow = 0;             // word a "beq" that isn't taken goes to
+    };
+
+    MicroOp decode(size_t index) const;
+    MicroOp *translate(size_t index, const void *const *handlers);
+    void flush();
+
+    std::vector<uint32_t> memory_;
+    size_t program_words_;
+    std::vector<MicroOp> ops_;      // the translated blocks, one after the other, never reallocated
+    std::vector<MicroOp *> blocks_; // the block at every word, nullptr if there is none
+    int32_t registers_[SINK + 1] = {};
+    uint32_t pc_ = 0;
+};
+
+#endif
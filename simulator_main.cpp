@@ -0,0 +1,116 @@
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "definitions.hpp"
+#include "output.hpp"
+#include "simulator.hpp"
+#include "source.hpp"
+
+// most memory --memory may ask for, it is all allocated before the run
+constexpr uint64_t MAX_MEMORY_BYTES = uint64_t(1) << 30;
+
+void printUsage(const char *executable) {
+    std::cerr << "usage: " << executable << " [options] instruction_file\n"
+              << "options: --format=hex|bin --endian=big|little --memory=BYTES --max-instructions=N\n";
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Parses the decimal number behind the '=' of an option.
+ *
+ * @return bool false unless the rest of arg is a number from 0 to max
+ */
+bool optionNumber(const std::string &arg, size_t prefix, uint64_t max, uint64_t &value) {
+    const char *const end = arg.data() + arg.size();
+    const auto [last, error] = std::from_chars(arg.data() + prefix, end, value);
+    return error == std::errc() && last == end && value <= max;
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Writes the registers that aren't 0 to stdout.
+ */
+void printRegisters(const Simulator &simulator) {
+    for (const auto &reg: REGISTER_ABRV) {
+        const int32_t value = simulator.reg(reg.number);
+        if (value == 0) continue;
+        char line[64];
+        std::snprintf(line, sizeof(line), "%-6s 0x%08x %d\n", std::string(reg.name).c_str(),
+                      static_cast<uint32_t>(value), value);
+        std::cout << line;
+    }
+}
+
+// --------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+    // call like "./executable [options] output_instructions", the file the
+    // assembler wrote, "-" reads stdin
+    int format = OUTPUT_FORMAT_HEX;
+    bool big_endian = true;
+    size_t memory_bytes = 1 << 20;
+    uint64_t max_instructions = 0;
+    bool valid_options = true;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--format=hex") {
+            format = OUTPUT_FORMAT_HEX;
+        } else if (arg == "--format=bin") {
+            format = OUTPUT_FORMAT_BIN;
+        } else if (arg == "--endian=big") {
+            big_endian = true;
+        } else if (arg == "--endian=little") {
+            big_endian = false;
+        } else if (arg.rfind("--memory=", 0) == 0) {
+            // up to MAX_MEMORY_BYTES, anything else is a usage error
+            uint64_t bytes = 0;
+            if (!optionNumber(arg, 9, MAX_MEMORY_BYTES, bytes)) valid_options = false;
+            memory_bytes = static_cast<size_t>(bytes);
+        } else if (arg.rfind("--max-instructions=", 0) == 0) {
+            if (!optionNumber(arg, 19, UINT64_MAX, max_instructions)) valid_options = false;
+        } else if (arg.size() > 1 && arg[0] == '-' && arg[1] == '-') {
+            valid_options = false;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (!valid_options || paths.size() != 1) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    SourceFile imageReader;
+    if (!imageReader.open(paths[0])) {
+        std::cerr << "Error: File could not be opened: " << paths[0] << "\n";
+        return EXIT_FAILURE;
+    }
+    std::vector<uint32_t> program;
+    if (!loadImage(imageReader.contents(), format, big_endian, program)) {
+        std::cerr << "Error: " << paths[0] << " is no image in the given format, word " << program.size()
+                  << " can't be read\n";
+        return EXIT_FAILURE;
+    }
+    imageReader.close();
+
+    Simulator simulator(program, memory_bytes);
+    const auto start = std::chrono::steady_clock::now();
+    const SimulationResult result = simulator.run(max_instructions);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printRegisters(simulator);
+    const char *const STOPS[] = {"halted", "ran past the end", "reached the instruction limit", "fault"};
+    char pc[16];
+    std::snprintf(pc, sizeof(pc), "0x%08x", result.pc);
+    std::cerr << "mips-sim: " << STOPS[result.status] << " at " << pc;
+    if (result.status == SIM_FAULT) std::cerr << ": " << result.fault;
+    std::cerr << ", " << result.instructions << " instructions in " << seconds * 1e3 << " ms, "
+              << (seconds > 0 ? result.instructions / seconds / 1e6 : 0.0) << " MIPS\n";
+    return result.status == SIM_FAULT ? EXIT_FAILURE : 0;
+}
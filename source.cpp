@@ -0,0 +1,99 @@
+#include "source.hpp"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SourceFile::~SourceFile() {
+    close();
+}
+
+// --------------------------------------------------------
+
+bool SourceFile::open(const std::string &path) {
+    close();
+
+    if (path == "-") {
+        is_open_ = readAll(STDIN_FILENO);
+        return is_open_;
+    }
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info {};
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        if (info.st_size == 0) {
+            is_open_ = true;
+        } else {
+            void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+                data_ = static_cast<const char *>(mapping);
+                size_ = info.st_size;
+                mapped_ = true;
+                is_open_ = true;
+            }
+        }
+    }
+    // not a regular file or mapping failed
+    if (!is_open_) is_open_ = readAll(fd);
+
+    ::close(fd);
+    return is_open_;
+}
+
+// --------------------------------------------------------
+
+void SourceFile::close() {
+    if (mapped_) munmap(const_cast<char *>(data_), size_);
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+    is_open_ = false;
+}
+
+// --------------------------------------------------------
+
+/**
+ * @brief Reads everything from fd into the buffer.
+ *
+ * @param fd file descriptor to read from until end of file
+ * @return bool false if reading failed
+ */
+bool SourceFile::readAll(int fd) {
+    char chunk[1 << 16];
+    while (true) {
+        const ssize_t count = read(fd, chunk, sizeof(chunk));
+        if (count == 0) break;
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) return false;
+        buffer_.append(chunk, count);
+    }
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+    return true;
+}
+
+// --------------------------------------------------------
+
+std::vector<std::string_view> splitChunks(std::string_view text, size_t count) {
+    std::vector<std::string_view> chunks;
+    if (count == 0) count = 1;
+    const size_t target = text.size() / count + 1;
+    while (!text.empty()) {
+        size_t end = text.size();
+        if (target < text.size()) {
+            end = text.find('\n', target - 1);
+            end = end == std::string_view::npos ? text.size() : end + 1;
+        }
+        chunks.push_back(text.substr(0, end));
+        text.remove_prefix(end);
+    }
+    return chunks;
+}
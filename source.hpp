@@ -0,0 +1,79 @@
+#ifndef MIPS_SOURCE_H
+#define MIPS_SOURCE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Read-only contents of a source file. Regular files are mapped into
+ * memory, so lines and tokens can point into the file without copying it.
+ * Everything that can't be mapped (stdin, pipes) is read into a buffer once.
+ */
+class SourceFile {
+public:
+    SourceFile() = default;
+    ~SourceFile();
+    SourceFile(const SourceFile &) = delete;
+    SourceFile &operator=(const SourceFile &) = delete;
+
+    /**
+     * @brief Opens and maps the file.
+     *
+     * @param path path of the file, "-" reads stdin
+     * @return bool true if the contents are available
+     */
+    bool open(const std::string &path);
+    void close();
+
+    bool is_open() const { return is_open_; }
+    std::string_view contents() const { return {data_, size_}; }
+
+private:
+    bool readAll(int fd);
+
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    bool is_open_ = false;
+    bool mapped_ = false;
+    std::string buffer_;  // contents if the file couldn't be mapped
+};
+
+// --------------------------------------------------------
+
+/**
+ * @brief Splits text into lines the same way getline does: at every '\n',
+ * the line break itself isn't part of the line and there is no empty line
+ * after a trailing '\n'.
+ */
+class LineReader {
+public:
+    explicit LineReader(std::string_view text) : rest_(text) {}
+
+    bool next(std::string_view &line) {
+        if (rest_.empty()) return false;
+        const size_t end = rest_.find('\n');
+        if (end == std::string_view::npos) {
+            line = rest_;
+            rest_ = {};
+        } else {
+            line = rest_.substr(0, end);
+            rest_.remove_prefix(end + 1);
+        }
+        return true;
+    }
+
+private:
+    std::string_view rest_;
+};
+
+// --------------------------------------------------------
+
+/**
+ * @brief Splits text into at most count pieces of about the same size. Every
+ * piece but the last ends with a '\n', so a LineReader over the pieces sees
+ * exactly the lines of the whole text.
+ */
+std::vector<std::string_view> splitChunks(std::string_view text, size_t count);
+
+#endif
@@ -0,0 +1,212 @@
+#include "stats.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+
+#include <sys/resource.h>
+
+#include "trace.hpp"
+
+namespace {
+
+const char *const PHASE_NAMES[STATS_PHASE_COUNT] = {
+    "read", "firstPass", "secondPass", "encode", "listing", "symbols",
+};
+
+std::atomic<bool> enabled{false};
+std::atomic<int64_t> start_ns{0};
+std::atomic<int64_t> phase_wall_ns[STATS_PHASE_COUNT];
+std::atomic<int64_t> phase_cpu_ns[STATS_PHASE_COUNT];
+std::atomic<uint64_t> phase_runs[STATS_PHASE_COUNT];
+std::atomic<uint64_t> phase_allocations[STATS_PHASE_COUNT];
+std::atomic<uint64_t> phase_allocated_bytes[STATS_PHASE_COUNT];
+std::atomic<int> phase_active[STATS_PHASE_COUNT];        // timers with wall time running
+std::atomic<int64_t> phase_peak_bytes[STATS_PHASE_COUNT];  // most heap in use while it ran
+std::atomic<int64_t> heap_bytes{0};                        // heap in use, from the replaced new
+std::atomic<int64_t> heap_peak_bytes{0};
+std::atomic<uint64_t> counters[STATS_COUNTER_COUNT];
+
+// allocations of the calling thread, the timers count the difference
+thread_local uint64_t thread_allocations = 0;
+thread_local uint64_t thread_allocated_bytes = 0;
+
+int64_t wallNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t threadCpuNow() {
+    timespec now {};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+double milliseconds(int64_t ns) {
+    return ns / 1e6;
+}
+
+double milliseconds(const timeval &time) {
+    return time.tv_sec * 1e3 + time.tv_usec / 1e3;
+}
+
+void raise(std::atomic<int64_t> &peak, int64_t value) {
+    int64_t known = peak.load(std::memory_order_relaxed);
+    while (known < value && !peak.compare_exchange_weak(known, value, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief Raises the peaks of the running phases to the heap in use.
+ */
+void notePeaks(int64_t bytes) {
+    raise(heap_peak_bytes, bytes);
+    for (int phase = 0; phase < STATS_PHASE_COUNT; ++phase) {
+        if (phase_active[phase].load(std::memory_order_relaxed) > 0) raise(phase_peak_bytes[phase], bytes);
+    }
+}
+
+double perLine(uint64_t count) {
+    return counters[STATS_LINES] == 0 ? 0.0 : static_cast<double>(count) / counters[STATS_LINES];
+}
+
+}  // namespace
+
+// --------------------------------------------------------
+
+void enableStats() {
+    start_ns = wallNow();
+    heap_peak_bytes = heap_bytes.load();
+    enabled = true;
+}
+
+bool statsEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void addStat(int counter, uint64_t value) {
+    if (statsEnabled()) counters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+void countAllocation(size_t size, size_t heap_size) {
+    // the heap in use is followed from the start, its memory may be freed
+    // after enableStats
+    const int64_t bytes = heap_bytes.fetch_add(heap_size, std::memory_order_relaxed) + heap_size;
+    if (!statsEnabled()) return;
+    ++thread_allocations;
+    thread_allocated_bytes += size;
+    counters[STATS_ALLOCATIONS].fetch_add(1, std::memory_order_relaxed);
+    counters[STATS_ALLOCATED_BYTES].fetch_add(size, std::memory_order_relaxed);
+    notePeaks(bytes);
+}
+
+void countDeallocation(size_t heap_size) {
+    heap_bytes.fetch_sub(heap_size, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------
+
+PhaseTimer::PhaseTimer(int phase, bool wall)
+    : phase_(phase)
+    , wall_(wall)
+    , enabled_(statsEnabled()) {
+    // the parts of a phase on other threads have spans of their own
+    if (wall_ && traceEnabled()) trace_begin_ = traceNow();
+    if (!enabled_) return;
+    if (wall_) {
+        wall_start_ = wallNow();
+        // the peak of this run starts with the heap in use now
+        phase_active[phase_].fetch_add(1, std::memory_order_relaxed);
+        raise(phase_peak_bytes[phase_], heap_bytes.load(std::memory_order_relaxed));
+    }
+    cpu_start_ = threadCpuNow();
+    allocations_start_ = thread_allocations;
+    allocated_bytes_start_ = thread_allocated_bytes;
+}
+
+PhaseTimer::~PhaseTimer() {
+    if (trace_begin_ >= 0) traceSpan(PHASE_NAMES[phase_], trace_begin_);
+    if (!enabled_) return;
+    phase_cpu_ns[phase_].fetch_add(threadCpuNow() - cpu_start_, std::memory_order_relaxed);
+    phase_allocations[phase_].fetch_add(thread_allocations - allocations_start_, std::memory_order_relaxed);
+    phase_allocated_bytes[phase_].fetch_add(thread_allocated_bytes - allocated_bytes_start_, std::memory_order_relaxed);
+    if (!wall_) return;
+    phase_wall_ns[phase_].fetch_add(wallNow() - wall_start_, std::memory_order_relaxed);
+    phase_runs[phase_].fetch_add(1, std::memory_order_relaxed);
+    phase_active[phase_].fetch_sub(1, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------
+
+std::string statsReport() {
+#ifdef MIPS_ALLOCATION_STATS
+    constexpr bool ALLOCATIONS = true;
+#else
+    constexpr bool ALLOCATIONS = false;
+#endif
+    char line[160];
+    std::string report = "stats:\n";
+    std::snprintf(line, sizeof(line), "%-14s %12s %12s %8s", "phase", "wall ms", "cpu ms", "runs");
+    report += line;
+    if (ALLOCATIONS) {
+        // peak KB: the most heap in use while the phase ran
+        std::snprintf(line, sizeof(line), " %10s %9s %10s %10s", "allocs", "per line", "alloc KB", "peak KB");
+        report += line;
+    }
+    report += '\n';
+    for (int phase = 0; phase < STATS_PHASE_COUNT; ++phase) {
+        if (phase_runs[phase] == 0 && phase_cpu_ns[phase] == 0) continue;
+        // the parts of secondPass are indented
+        const int indent = phase > STATS_SECOND_PASS ? 2 : 0;
+        if (phase_runs[phase] != 0) {
+            std::snprintf(line, sizeof(line), "%*s%-*s %12.3f %12.3f %8llu", indent, "", 14 - indent,
+                          PHASE_NAMES[phase], milliseconds(phase_wall_ns[phase]), milliseconds(phase_cpu_ns[phase]),
+                          static_cast<unsigned long long>(phase_runs[phase]));
+        } else {
+            // only ran in tasks of the worker threads, there is no wall time
+            std::snprintf(line, sizeof(line), "%*s%-*s %12s %12.3f %8s", indent, "", 14 - indent,
+                          PHASE_NAMES[phase], "-", milliseconds(phase_cpu_ns[phase]), "-");
+        }
+        report += line;
+        if (ALLOCATIONS) {
+            std::snprintf(line, sizeof(line), " %10llu %9.3f %10llu",
+                          static_cast<unsigned long long>(phase_allocations[phase]), perLine(phase_allocations[phase]),
+                          static_cast<unsigned long long>(phase_allocated_bytes[phase] / 1024));
+            report += line;
+            if (phase_runs[phase] != 0) {
+                std::snprintf(line, sizeof(line), " %10lld", static_cast<long long>(phase_peak_bytes[phase] / 1024));
+            } else {
+                std::snprintf(line, sizeof(line), " %10s", "-");
+            }
+            report += line;
+        }
+        report += '\n';
+    }
+
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    std::snprintf(line, sizeof(line), "%-14s %12.3f %12.3f", "total", milliseconds(wallNow() - start_ns),
+                  milliseconds(usage.ru_utime) + milliseconds(usage.ru_stime));
+    report += line;
+    if (ALLOCATIONS) {
+        std::snprintf(line, sizeof(line), " %8s %10llu %9.3f %10llu %10lld", "",
+                      static_cast<unsigned long long>(counters[STATS_ALLOCATIONS]), perLine(counters[STATS_ALLOCATIONS]),
+                      static_cast<unsigned long long>(counters[STATS_ALLOCATED_BYTES] / 1024),
+                      static_cast<long long>(heap_peak_bytes / 1024));
+        report += line;
+    }
+    report += '\n';
+
+    // the resident set of the whole process, it can't be split by phase
+    std::snprintf(line, sizeof(line), "process peak RSS %ld KB\n", usage.ru_maxrss);
+    report += line;
+
+    std::snprintf(line, sizeof(line), "lines %llu, instructions %llu, labels %llu, bytes written %llu\n",
+                  static_cast<unsigned long long>(counters[STATS_LINES]),
+                  static_cast<unsigned long long>(counters[STATS_INSTRUCTIONS]),
+                  static_cast<unsigned long long>(counters[STATS_LABELS]),
+                  static_cast<unsigned long long>(counters[STATS_BYTES_WRITTEN]));
+    report += line;
+    return report;
+}
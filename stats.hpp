@@ -0,0 +1,93 @@
+#ifndef MIPS_STATS_H
+#define MIPS_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// phases timed for --stats, STATS_ENCODE to STATS_SYMBOLS are part of
+// STATS_SECOND_PASS
+enum {
+    STATS_READ,         // opening and reading the source
+    STATS_FIRST_PASS,   // finding the labels
+    STATS_SECOND_PASS,  // everything after the labels are known
+    STATS_ENCODE,       // encoding the instructions (encodeProgram)
+    STATS_LISTING,      // formatting the listing (listProgram)
+    STATS_SYMBOLS,      // the symbol dump at the end of the listing
+    STATS_PHASE_COUNT
+};
+
+// counters reported by --stats
+enum {
+    STATS_LINES,
+    STATS_INSTRUCTIONS,
+    STATS_LABELS,
+    STATS_BYTES_WRITTEN,  // bytes written to output files
+    STATS_ALLOCATIONS,    // calls of operator new, with MIPS_ALLOCATION_STATS
+    STATS_ALLOCATED_BYTES,
+    STATS_COUNTER_COUNT
+};
+
+/**
+ * @brief Starts collecting timings and counters. Until then timers and
+ * counters do nothing, so the instrumentation costs a load and a branch.
+ */
+void enableStats();
+bool statsEnabled();
+
+/**
+ * @brief Adds value to a counter. Safe to call from any thread.
+ */
+void addStat(int counter, uint64_t value);
+
+/**
+ * @brief Counts a heap allocation, called by the operators new that
+ * mips-assembler replaces when built with MIPS_ALLOCATION_STATS.
+ *
+ * @param size the bytes asked for
+ * @param heap_size the bytes the heap handed out, 0 if that isn't known
+ */
+void countAllocation(size_t size, size_t heap_size);
+
+/**
+ * @brief Counts memory given back by the replaced operators delete.
+ *
+ * @param heap_size the bytes the heap handed out for it, 0 if unknown
+ */
+void countDeallocation(size_t heap_size);
+
+/**
+ * @brief Adds the wall and CPU time of its scope to a phase. The CPU time is
+ * the one of the calling thread. A phase that runs on several threads gets
+ * one timer for the thread that waits for the others (wall time) and one
+ * timer without wall time in every task (CPU time). Heap allocations are
+ * counted the same way. While a timer with wall time runs, the heap in use
+ * is followed for the peak of its phase, and with --trace it is recorded as
+ * a span named after its phase.
+ */
+class PhaseTimer {
+public:
+    explicit PhaseTimer(int phase, bool wall = true);
+    ~PhaseTimer();
+    PhaseTimer(const PhaseTimer &) = delete;
+    PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+private:
+    int phase_;
+    bool wall_;
+    bool enabled_;
+    int64_t wall_start_ = 0;
+    int64_t cpu_start_ = 0;
+    uint64_t allocations_start_ = 0;
+    uint64_t allocated_bytes_start_ = 0;
+    double trace_begin_ = -1;  // negative while not tracing
+};
+
+/**
+ * @brief Table of the phases that ran, the counters and the time and CPU
+ * time of the whole process since enableStats. Allocations are only listed
+ * when they are counted.
+ */
+std::string statsReport();
+
+#endif
@@ -0,0 +1,294 @@
+#include "stream.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <deque>
+#include <limits>
+#include <map>
+#include <set>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "instruction.hpp"
+#include "lexer.hpp"
+#include "passes.hpp"
+#include "stats.hpp"
+#include "symbols.hpp"
+
+namespace {
+
+constexpr size_t READ_SIZE = 1 << 16;
+constexpr size_t NO_ERROR = std::numeric_limits<size_t>::max();
+
+// an encoded instruction that isn't written yet
+struct QueuedWord {
+    uint32_t word = 0;
+    size_t line = 0;        // 1-based source line
+    bool encoded = false;   // false while its label is unknown
+};
+
+// a "j" or "beq" whose label isn't defined yet
+struct ForwardReference {
+    size_t word;         // index of its QueuedWord, counted from the first word
+    int address;         // address of the instruction
+    size_t line;         // 1-based source line
+    bool hex_numbers;    // an instruction was listed in front of it
+    std::string text;    // the source line, decoded again once the label is known
+};
+
+/**
+ * @brief State of assembleStream between two lines. Lines are handled like
+ * onePass handles them, but instead of keeping every line until the end only
+ * the forward references are kept, and the words in front of the first one
+ * are written right away.
+ */
+class StreamAssembler {
+public:
+    StreamAssembler(OutputBuffer &output, int format, bool big_endian, StreamReport &report)
+        : output_(output), format_(format), big_endian_(big_endian), report_(report) {}
+
+    bool stopped() const { return stopped_; }
+
+    /**
+     * @brief Assembles the next line of the source.
+     */
+    void line(std::string_view text) {
+        const size_t line = ++report_.lines;
+        const LineTokens tokens = lexLine(text);
+        if (tokens.has_code) {
+            if (!tokens.label.empty()) defineLabel(tokens, line);
+            if (!tokens.label_single) addrPointer_ += 4;
+        }
+        // after an error only the labels matter, they may still resolve the
+        // references in front of it
+        if (stopped_ || error_line_ != NO_ERROR) return;
+
+        Instruction instruction;
+        if (!parseInstruction(tokens, instruction)) {
+            fail(line, "Error: Argument too long.\n");
+            return;
+        }
+        if (instruction.kind == INSTRUCTION_NONE) return;
+
+        const bool hex_numbers = first_code_line_ < line;
+        if (instruction.kind == INSTRUCTION_CODE) first_code_line_ = std::min(first_code_line_, line);
+        queue_.push_back({0, line, false});
+        const size_t word = first_queued_ + queue_.size() - 1;
+        if (!instruction.jump_label.empty()) {
+            used_.emplace(instruction.jump_label);
+            const int *labelAddr = symbols_.find(instruction.jump_label, instruction.jump_hash);
+            if (labelAddr == nullptr) {
+                auto waiting = references_.find(instruction.jump_label);
+                if (waiting == references_.end()) {
+                    waiting = references_.emplace(std::string(instruction.jump_label), std::vector<ForwardReference>()).first;
+                }
+                waiting->second.push_back({word, instruction_count_, line, hex_numbers, std::string(text)});
+                waiting_bytes_ += text.size();
+                report_.max_waiting_bytes = std::max(report_.max_waiting_bytes, waiting_bytes_);
+                report_.max_waiting_words = std::max(report_.max_waiting_words, queue_.size());
+                if (!tokens.label_single) instruction_count_ += 4;
+                return;
+            }
+            resolveLabel(instruction, *labelAddr, instruction_count_);
+        }
+        encode(instruction, word, line, hex_numbers);
+        if (!tokens.label_single) instruction_count_ += 4;
+        writeReady();
+    }
+
+    /**
+     * @brief End of the source: references that are still open name labels
+     * that don't exist. Writes the words in front of the first error.
+     */
+    void finish(AssemblyResult &result) {
+        for (const auto &waiting: references_) {
+            for (const auto &reference: waiting.second) {
+                if (reference.line < error_line_) {
+                    error_line_ = reference.line;
+                    error_ = "Error: label '" + waiting.first + "' does not exist!\n";
+                }
+            }
+        }
+        writeReady();
+        output_.flush();
+
+        if (error_line_ != NO_ERROR) result.diagnostics.push_back({error_line_, error_});
+        if (!redefinition_.message.empty()) result.diagnostics.push_back(redefinition_);
+        result.ok = result.diagnostics.empty();
+        result.warnings = std::move(warnings_);
+        symbols_.sort();
+        addStat(STATS_LINES, report_.lines);
+        addStat(STATS_INSTRUCTIONS, report_.words);
+        addStat(STATS_LABELS, symbols_.size());
+        result.symbols.reserve(symbols_.size());
+        for (const auto &lbl: symbols_.symbols()) {
+            result.symbols.push_back({std::string(lbl.name), lbl.address});
+        }
+    }
+
+private:
+    void defineLabel(const LineTokens &tokens, size_t line) {
+        const std::string_view name = tokens.label.substr(0, tokens.label.size() - 1);
+        if (used_.count(name) != 0 && symbols_.find(name, tokens.label_hash) != nullptr) {
+            // words with the old address may already be written
+            redefinition_ = {line, "Error: label '" + std::string(name) +
+                                   "' is defined again after it was used, which the stream mode can't patch.\n"};
+            stopped_ = true;
+            return;
+        }
+        ::defineLabel(symbols_, tokens.label, tokens.label_hash, addrPointer_, line, warnings_);
+
+        const auto waiting = references_.find(name);
+        if (waiting == references_.end()) return;
+        for (const auto &reference: waiting->second) {
+            waiting_bytes_ -= reference.text.size();
+            // references behind an error are never written
+            if (reference.line >= error_line_) continue;
+            Instruction instruction;
+            parseInstruction(lexLine(reference.text), instruction);
+            resolveLabel(instruction, addrPointer_, reference.address);
+            encode(instruction, reference.word, reference.line, reference.hex_numbers);
+        }
+        references_.erase(waiting);
+        writeReady();
+    }
+
+    /**
+     * @brief Encodes an instruction into its QueuedWord, like outputPrinting
+     * but without listing it.
+     */
+    void encode(const Instruction &instruction, size_t word, size_t line, bool hex_numbers) {
+        // numbers in error messages are written like the listing writes them
+        errout_.setIntegerBase(hex_numbers ? 16 : 10);
+        try {
+            if (instruction.kind == INSTRUCTION_INVALID) {
+                throw AssemblyError("Error: Wrong amount of arguments, operation not supported.\n");
+            }
+            QueuedWord &queued = queue_[word - first_queued_];
+            queued.word = binInstruction(instruction, errout_);
+            queued.encoded = true;
+        } catch (const AssemblyError &error) {
+            fail(line, error.what());
+        }
+    }
+
+    void fail(size_t line, const std::string &message) {
+        if (line >= error_line_) return;
+        error_line_ = line;
+        error_ = message;
+    }
+
+    /**
+     * @brief Writes the encoded words at the front of the queue.
+     */
+    void writeReady() {
+        while (!queue_.empty() && queue_.front().encoded && queue_.front().line < error_line_) {
+            writeWord(queue_.front().word);
+            queue_.pop_front();
+            ++first_queued_;
+        }
+    }
+
+    void writeWord(uint32_t word) {
+        ++report_.words;
+        if (format_ == OUTPUT_FORMAT_HEX) {
+            output_.write("0x");
+            output_.hex8(word);
+            output_.put('\n');
+            return;
+        }
+        char bytes[4];
+        for (int i = 0; i < 4; ++i) {
+            const int shift = big_endian_ ? 24 - 8 * i : 8 * i;
+            bytes[i] = static_cast<char>((word >> shift) & 0xFF);
+        }
+        output_.write({bytes, sizeof(bytes)});
+    }
+
+    OutputBuffer &output_;
+    int format_;
+    bool big_endian_;
+    StreamReport &report_;
+
+    SymbolTable symbols_;
+    std::vector<Diagnostic> warnings_;
+    std::map<std::string, std::vector<ForwardReference>, std::less<>> references_;
+    std::set<std::string, std::less<>> used_;  // labels a "j" or "beq" named
+    std::deque<QueuedWord> queue_;
+    size_t first_queued_ = 0;  // index of queue_.front() among all words
+    size_t waiting_bytes_ = 0;
+    unsigned int addrPointer_ = 0;
+    int instruction_count_ = 0;
+    size_t first_code_line_ = NO_ERROR;
+    OutputBuffer errout_;  // never opened, only decides how numbers are written
+
+    size_t error_line_ = NO_ERROR;  // first line with an error so far
+    std::string error_;
+    Diagnostic redefinition_;
+    bool stopped_ = false;  // nothing more is read after a redefinition
+};
+
+}  // namespace
+
+// --------------------------------------------------------
+
+AssemblyResult assembleStream(const std::string &input,
+                              OutputBuffer &instructions,
+                              int format,
+                              bool big_endian,
+                              StreamReport &report) {
+    AssemblyResult result;
+    const int fd = input == "-" ? STDIN_FILENO : ::open(input.c_str(), O_RDONLY);
+    if (fd < 0) {
+        result.diagnostics.push_back({0, "Error: File could not be opened: " + input + "\n"});
+        return result;
+    }
+
+    StreamAssembler assembler(instructions, format, big_endian, report);
+    std::string buffer;   // the lines that aren't complete yet
+    size_t scanned = 0;   // bytes of buffer known to have no '\n'
+    bool read_failed = false;
+    while (!assembler.stopped()) {
+        // whatever is encoded goes out before waiting for more input
+        instructions.flush();
+        const size_t size = buffer.size();
+        buffer.resize(size + READ_SIZE);
+        ssize_t count;
+        {
+            PhaseTimer timer(STATS_READ);
+            count = ::read(fd, buffer.data() + size, READ_SIZE);
+        }
+        buffer.resize(size + std::max<ssize_t>(count, 0));
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) {
+            read_failed = count < 0;
+            break;
+        }
+
+        size_t begin = 0;
+        for (size_t end; !assembler.stopped() && (end = buffer.find('\n', scanned)) != std::string::npos;) {
+            report.max_line_bytes = std::max(report.max_line_bytes, end - begin);
+            assembler.line(std::string_view(buffer).substr(begin, end - begin));
+            begin = end + 1;
+            scanned = begin;
+        }
+        buffer.erase(0, begin);
+        scanned = buffer.size();
+    }
+    // like getline, a last line without '\n' is still a line
+    if (!assembler.stopped() && !read_failed && !buffer.empty()) {
+        report.max_line_bytes = std::max(report.max_line_bytes, buffer.size());
+        assembler.line(buffer);
+    }
+    if (fd != STDIN_FILENO) ::close(fd);
+
+    assembler.finish(result);
+    if (read_failed) {
+        result.ok = false;
+        result.diagnostics.push_back({0, "Error: File could not be read: " + input + "\n"});
+    }
+    return result;
+}
@@ -0,0 +1,48 @@
+#ifndef MIPS_STREAM_H
+#define MIPS_STREAM_H
+
+#include <cstddef>
+#include <string>
+
+#include "assembler.hpp"
+#include "output.hpp"
+
+// what assembleStream kept in memory
+struct StreamReport {
+    size_t lines = 0;              // source lines read
+    size_t words = 0;              // instructions written
+    size_t max_waiting_words = 0;  // most words held back by forward references at once
+    size_t max_waiting_bytes = 0;  // most source bytes kept for those references at once
+    size_t max_line_bytes = 0;     // longest line, the input buffer grows to hold it
+};
+
+/**
+ * @brief Assembles a program while it is read and writes every instruction as
+ * soon as it and all instructions in front of it are encoded. Only a "j" or
+ * "beq" to a label that isn't defined yet is held back, together with the
+ * words behind it, until the label shows up. Memory therefore grows with the
+ * distance of forward references and the number of labels, not with the size
+ * of the program. There is no listing.
+ *
+ * The instructions are the same as the ones assemble() writes, with two
+ * differences: OUTPUT_FORMAT_BIN is written as it goes, so a failing program
+ * leaves the words in front of the error like OUTPUT_FORMAT_HEX does, and a
+ * label that is defined again after a jump or branch used it is an error,
+ * since the words using the old address may already be written.
+ *
+ * @param input path of the source, "-" reads stdin
+ * @param instructions output for the encoded instructions, flushed whenever
+ * the input has to wait for more data
+ * @param format OUTPUT_FORMAT_HEX or OUTPUT_FORMAT_BIN
+ * @param big_endian byte order of OUTPUT_FORMAT_BIN
+ * @param report receives the counts and what was kept in memory
+ * @return AssemblyResult symbols, warnings and the errors, words and listing
+ * are empty
+ */
+AssemblyResult assembleStream(const std::string &input,
+                              OutputBuffer &instructions,
+                              int format,
+                              bool big_endian,
+                              StreamReport &report);
+
+#endif
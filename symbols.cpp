@@ -0,0 +1,70 @@
+#include "symbols.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr size_t MIN_SLOTS = 64;
+
+}  // namespace
+
+// --------------------------------------------------------
+
+bool SymbolTable::define(std::string_view name, uint32_t hash, int address) {
+    // at most half of the slots are used, so probing stays short
+    if (2 * (symbols_.size() + 1) > slots_.size()) {
+        rehash(std::max(MIN_SLOTS, 2 * slots_.size()));
+    }
+
+    const size_t mask = slots_.size() - 1;
+    size_t slot = hash & mask;
+    for (; slots_[slot] != 0; slot = (slot + 1) & mask) {
+        Symbol &symbol = symbols_[slots_[slot] - 1];
+        if (symbol.hash == hash && symbol.name == name) {
+            symbol.address = address;
+            return false;
+        }
+    }
+
+    char *interned = names_.allocate<char>(name.size());
+    if (!name.empty()) std::memcpy(interned, name.data(), name.size());
+    if (!symbols_.empty() && std::string_view(interned, name.size()) < symbols_.back().name) {
+        sorted_ = false;
+    }
+    symbols_.push_back({std::string_view(interned, name.size()), hash, address});
+    slots_[slot] = static_cast<uint32_t>(symbols_.size());
+    return true;
+}
+
+const int *SymbolTable::find(std::string_view name, uint32_t hash) const {
+    if (slots_.empty()) return nullptr;
+    const size_t mask = slots_.size() - 1;
+    for (size_t slot = hash & mask; slots_[slot] != 0; slot = (slot + 1) & mask) {
+        const Symbol &symbol = symbols_[slots_[slot] - 1];
+        if (symbol.hash == hash && symbol.name == name) return &symbol.address;
+    }
+    return nullptr;
+}
+
+// --------------------------------------------------------
+
+void SymbolTable::sort() {
+    if (sorted_) return;
+    std::sort(symbols_.begin(), symbols_.end(), [](const Symbol &a, const Symbol &b) {
+        return a.name < b.name;
+    });
+    sorted_ = true;
+    // the slots point at the old positions
+    rehash(slots_.size());
+}
+
+void SymbolTable::rehash(size_t slot_count) {
+    slots_.assign(slot_count, 0);
+    const size_t mask = slot_count - 1;
+    for (size_t i = 0; i < symbols_.size(); ++i) {
+        size_t slot = symbols_[i].hash & mask;
+        while (slots_[slot] != 0) slot = (slot + 1) & mask;
+        slots_[slot] = static_cast<uint32_t>(i + 1);
+    }
+}
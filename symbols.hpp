@@ -0,0 +1,82 @@
+#ifndef MIPS_SYMBOLS_H
+#define MIPS_SYMBOLS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "arena.hpp"
+#include "perfect_hash.hpp"
+
+/**
+ * @brief Hash of a label name without its ':'. The lexer and the instruction
+ * decoder compute it once, every lookup of the label reuses it.
+ */
+constexpr uint32_t labelHash(std::string_view name) {
+    return seededHash(name, 0);
+}
+
+/**
+ * @brief Label name to address. An open addressing hash table with linear
+ * probing, the names are copied into an arena so the table doesn't depend on
+ * the source. The order of the labels only matters for the symbol listing,
+ * which sorts them once.
+ */
+class SymbolTable {
+public:
+    struct Symbol {
+        std::string_view name;  // interned, without the ':'
+        uint32_t hash;
+        int address;
+    };
+
+    SymbolTable() = default;
+    SymbolTable(const SymbolTable &) = delete;
+    SymbolTable &operator=(const SymbolTable &) = delete;
+
+    /**
+     * @brief Stores the address of a label, a label that exists keeps its
+     * name and gets the new address.
+     *
+     * @param name label without its ':'
+     * @param hash labelHash(name)
+     * @return bool false if the label was defined before
+     */
+    bool define(std::string_view name, uint32_t hash, int address);
+
+    /**
+     * @brief Address of a label.
+     *
+     * @param name label without its ':'
+     * @param hash labelHash(name)
+     * @return const int* the address, nullptr if the label doesn't exist
+     */
+    const int *find(std::string_view name, uint32_t hash) const;
+
+    const int *find(std::string_view name) const { return find(name, labelHash(name)); }
+
+    /**
+     * @brief Sorts the symbols by name, lookups keep working. Sorting a sorted
+     * table does nothing.
+     */
+    void sort();
+
+    /**
+     * @brief The symbols in the order they were defined, sorted by name after
+     * sort().
+     */
+    const std::vector<Symbol> &symbols() const { return symbols_; }
+
+    size_t size() const { return symbols_.size(); }
+
+private:
+    void rehash(size_t slot_count);
+
+    std::vector<Symbol> symbols_;
+    std::vector<uint32_t> slots_;  // index into symbols_ plus one, 0 for a free slot
+    Arena names_;
+    bool sorted_ = true;
+};
+
+#endif
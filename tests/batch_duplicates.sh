@@ -0,0 +1,34 @@
+#!/bin/sh
+# usage: batch_duplicates.sh mips-assembler files_dir
+# Two sources named prog.s in different directories would share their
+# outputs in one batch; the batch must fail without writing them.
+set -u
+assembler=$1
+files=$2
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+mkdir "$work/a" "$work/b" "$work/out"
+cp "$files/program1.txt" "$work/a/prog.s"
+cp "$files/program2.txt" "$work/b/prog.s"
+printf '%s\n%s\n' "$work/a/prog.s" "$work/b/prog.s" > "$work/list"
+
+if "$assembler" --batch --jobs=2 "$work/list" "$work/out" 2> "$work/stderr"; then
+    echo "batch with duplicate outputs succeeded"
+    exit 1
+fi
+if ! grep -q "would both be written to $work/out/prog.s.hex" "$work/stderr"; then
+    echo "missing diagnostic, stderr was:"
+    cat "$work/stderr"
+    exit 1
+fi
+if [ -e "$work/out/prog.s.hex" ] || [ -e "$work/out/prog.s.lst" ]; then
+    echo "outputs were written"
+    exit 1
+fi
+
+# distinct names still work
+cp "$files/program2.txt" "$work/b/other.s"
+printf '%s\n%s\n' "$work/a/prog.s" "$work/b/other.s" > "$work/list"
+"$assembler" --batch --jobs=2 "$work/list" "$work/out" || exit 1
+[ -s "$work/out/prog.s.hex" ] && [ -s "$work/out/other.s.hex" ]
@@ -0,0 +1,113 @@
+#!/bin/sh
+# usage: differential.sh mips-assembler mips-generate files_dir
+# Assembles the example programs and generated ones in every mode and
+# compares listing, instructions, stderr and exit code with a plain run:
+# --one-pass, chunks on several threads (--jobs), --no-listing, --stream,
+# --cache-dir (a miss and a hit) and --incremental over a sequence of edits.
+set -u
+assembler=$1
+generate=$2
+files=$3
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+failures=0
+
+# runs the assembler on a source into $work/<name>.lst/.hex/.err/.rc
+run() {
+    name=$1
+    shift
+    "$assembler" "$@" "$work/$name.lst" "$work/$name.hex" > /dev/null 2> "$work/$name.err"
+    echo $? > "$work/$name.rc"
+}
+
+# compares the outputs of a mode with the ones of the plain run
+same() {
+    mode=$1
+    shift
+    for part in "$@"; do
+        if ! cmp -s "$work/plain.$part" "$work/$mode.$part"; then
+            echo "$source: $mode differs in $part"
+            diff "$work/plain.$part" "$work/$mode.$part" | head -5
+            failures=$((failures + 1))
+        fi
+    done
+}
+
+# every mode on one source
+check() {
+    source=$1
+    run plain "$source"
+
+    run onepass --one-pass "$source"
+    same onepass lst hex err rc
+
+    run jobs --jobs=4 "$source"
+    same jobs lst hex err rc
+
+    "$assembler" --no-listing "$source" "$work/nolist.hex" > /dev/null 2> /dev/null
+    echo $? > "$work/nolist.rc"
+    same nolist hex rc
+
+    "$assembler" --stream "$source" "$work/stream.hex" > /dev/null 2> /dev/null
+    echo $? > "$work/stream.rc"
+    same stream rc
+    if [ "$(cat "$work/plain.rc")" -eq 0 ]; then same stream hex; fi
+
+    rm -rf "$work/cache"
+    run miss --cache-dir="$work/cache" "$source"
+    same miss lst hex err rc
+    run hit --cache-dir="$work/cache" "$source"
+    same hit lst hex err rc
+}
+
+# the lines of a program changed step by step, every step assembled
+# incrementally from the outputs of the step before
+edits() {
+    source=$1
+    cp "$source" "$work/edited.s"
+    rm -f "$work/state" "$work/inc.lst" "$work/inc.hex"
+    lines=$(wc -l < "$work/edited.s")
+    step=0
+    while [ $step -lt 15 ]; do
+        line=$(( (step * 7919 + 13) % lines + 1 ))
+        case $((step % 5)) in
+            0) awk -v n=$line 'NR == n { print "\tadd    $t0, $t1, $t2  # inserted" } { print }' ;;
+            1) awk -v n=$line 'NR != n' ;;
+            2) awk -v n=$line 'NR == n { sub(/\$t0/, "$s1") } { print }' ;;
+            3) awk -v n=$line 'NR == n { print "E" n ":" } { print }' ;;
+            # labels only, the line takes an address without an instruction
+            4) awk -v n=$line 'NR == n { print "F" n ": G" n ":" } { print }' ;;
+        esac < "$work/edited.s" > "$work/next.s"
+        mv "$work/next.s" "$work/edited.s"
+        lines=$(wc -l < "$work/edited.s")
+
+        source="$work/edited.s (edit $step)"
+        run plain "$work/edited.s"
+        run inc --incremental="$work/state" "$work/edited.s"
+        same inc lst hex err rc
+        step=$((step + 1))
+    done
+}
+
+for program in "$files"/program*.txt; do
+    check "$program"
+    edits "$program"
+done
+
+for seed in 1 2 3; do
+    "$generate" --lines=2000 --seed=$seed > "$work/generated$seed.s"
+    check "$work/generated$seed.s"
+    edits "$work/generated$seed.s"
+done
+
+# large enough to be split into chunks, once with an error in the middle
+"$generate" --lines=40000 --seed=4 > "$work/large.s"
+check "$work/large.s"
+edits "$work/large.s"
+awk 'NR == 20000 { print "\taddi $t0, $t1" } { print }' "$work/large.s" > "$work/broken.s"
+check "$work/broken.s"
+
+if [ $failures -ne 0 ]; then
+    echo "$failures differences"
+    exit 1
+fi
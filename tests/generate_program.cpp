@@ -0,0 +1,41 @@
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "synthetic.hpp"
+
+// --------------------------------------------------------
+
+/**
+ * @brief Reads the unsigned number behind prefix in arg.
+ *
+ * @return bool false if arg doesn't start with prefix or the rest isn't a
+ * number
+ */
+bool parseNumber(const char *arg, const char *prefix, size_t &value) {
+    const size_t length = std::strlen(prefix);
+    if (std::strncmp(arg, prefix, length) != 0) return false;
+    const char *end = arg + std::strlen(arg);
+    const auto [parsed, error] = std::from_chars(arg + length, end, value);
+    return error == std::errc() && parsed == end;
+}
+
+int main(int argc, char *argv[]) {
+    // call like "./mips-generate --lines=1000 --seed=7", writes the program
+    // of the benchmarks with the default mix to stdout
+    ProgramMix mix;
+    for (int i = 1; i < argc; ++i) {
+        size_t value = 0;
+        if (parseNumber(argv[i], "--lines=", value)) {
+            mix.lines = value;
+        } else if (parseNumber(argv[i], "--seed=", value)) {
+            mix.seed = static_cast<uint32_t>(value);
+        } else {
+            std::fprintf(stderr, "usage: %s [--lines=N] [--seed=N]\n", argv[0]);
+            return 1;
+        }
+    }
+    const std::string source = syntheticSource(mix);
+    return std::fwrite(source.data(), 1, source.size(), stdout) == source.size() ? 0 : 1;
+}
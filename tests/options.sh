@@ -0,0 +1,44 @@
+#!/bin/sh
+# usage: options.sh mips-assembler mips-sim files_dir
+# Malformed option values are usage errors, not crashes.
+set -u
+assembler=$1
+simulator=$2
+files=$3
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+source="$files/program1.txt"
+
+for jobs in 0 -1 4x "" 1025 99999999999999999999999; do
+    "$assembler" --jobs="$jobs" "$source" "$work/out.lst" "$work/out.hex" 2> "$work/stderr"
+    status=$?
+    if [ "$status" -ne 1 ] || ! grep -q "^usage:" "$work/stderr"; then
+        echo "--jobs=$jobs: exit code $status"
+        cat "$work/stderr"
+        exit 1
+    fi
+done
+for jobs in 1 4 1024; do
+    "$assembler" --jobs="$jobs" "$source" "$work/out.lst" "$work/out.hex" || exit 1
+done
+
+"$assembler" --no-listing "$source" "$work/out.hex" || exit 1
+for option in --memory=-1 --memory=4x --memory= --memory=1073741825 --memory=99999999999999999999999 \
+              --max-instructions=-1 --max-instructions= --max-instructions=99999999999999999999999; do
+    "$simulator" "$option" "$work/out.hex" > /dev/null 2> "$work/stderr"
+    status=$?
+    if [ "$status" -ne 1 ] || ! grep -q "^usage:" "$work/stderr"; then
+        echo "$option: exit code $status"
+        cat "$work/stderr"
+        exit 1
+    fi
+done
+# the example may not end by itself
+for option in --memory=1073741824 --memory=64; do
+    "$simulator" "$option" --max-instructions=1000 "$work/out.hex" > /dev/null 2>&1
+    status=$?
+    if [ "$status" -gt 1 ]; then
+        echo "$option: exit code $status"
+        exit 1
+    fi
+done
@@ -0,0 +1,24 @@
+# fills an array with 1..16 and adds it up again, through the fused
+# add/lw, add/sw and addi/beq and a beq with a j behind it
+	addi $t1, $zero, 64     # end of the array
+	addi $s2, $zero, 1024   # the array
+	addi $t0, $zero, 0
+fill:
+	addi $t3, $t3, 1
+	add  $t2, $s2, $t0
+	sw   $t3, 0($t2)
+	addi $t0, $t0, 4
+	beq  $t0, $t1, sum
+	j    fill
+sum:
+	addi $t0, $zero, 0
+next:
+	add  $t2, $s2, $t0
+	lw   $t4, 0($t2)
+	add  $s0, $s0, $t4
+	addi $t0, $t0, 4
+	beq  $t0, $t1, done
+	j    next
+done:
+	lw   $s1, 60($s2)       # the last element
+	exit
@@ -0,0 +1,14 @@
+# options: --max-instructions=1000
+# a sw replaces the beq of a fused addi/beq pair whose block already ran,
+# the pair must be translated again
+	addi $t1, $zero, 2
+	lw   $t2, 32($zero)     # the exit at the end
+	j    loop               # loop gets a block of its own
+loop:
+	addi $s0, $s0, 1
+	beq  $s0, $t1, again    # address 16
+	j    loop
+again:
+	sw   $t2, 16($zero)
+	j    loop
+	exit                    # address 32, only runs in place of the beq
@@ -0,0 +1,12 @@
+# jr back into the middle of a block that already ran, then a sll of the
+# result
+	addi $t0, $zero, 3
+	addi $s0, $zero, 8
+back:
+	addi $t0, $t0, -1
+	add  $s1, $s1, $t0
+	beq  $t0, $zero, out
+	jr   $s0
+out:
+	sll  $s2, $s1, 2
+	exit
@@ -0,0 +1,6 @@
+# options: --max-instructions=100
+# never ends, stops behind the first jump after 100 instructions
+loop:
+	addi $t0, $t0, 1
+	add  $t1, $t1, $t0
+	j    loop
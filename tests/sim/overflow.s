@@ -0,0 +1,5 @@
+# stops with a fault at the add that overflows
+	addi $t0, $zero, 1
+	sll  $t0, $t0, 30
+	add  $t1, $t0, $t0
+	addi $s0, $zero, 1
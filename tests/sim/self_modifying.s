@@ -0,0 +1,17 @@
+# a sw in the second round replaces an instruction of the block that is
+# running, the third round must run the new instruction
+	addi $t1, $zero, 3
+	addi $t3, $zero, 1
+	lw   $t2, 44($zero)     # the addi behind exit
+	j    loop               # loop gets a block of its own
+loop:
+	addi $t0, $t0, 1
+	addi $s0, $s0, 1        # address 20, replaced in the second round
+	beq  $t0, $t3, skip     # the first round doesn't store
+	sw   $t2, 20($zero)
+skip:
+	beq  $t0, $t1, end
+	j    loop
+end:
+	exit
+	addi $s1, $s1, 1        # address 44, never reached
@@ -0,0 +1,31 @@
+#!/bin/sh
+# usage: simulator.sh mips-assembler mips-sim sim_dir
+# Assembles every sim_dir/*.s, runs it and compares the registers and the
+# reason it stopped with sim_dir/*.expected. A line "# options: ..." in a
+# program passes options to mips-sim.
+set -u
+assembler=$1
+simulator=$2
+dir=$3
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+failures=0
+
+for program in "$dir"/*.s; do
+    name=$(basename "$program" .s)
+    options=$(sed -n 's/^# options: //p' "$program")
+    if ! "$assembler" --no-listing "$program" "$work/$name.hex"; then
+        echo "$name: could not be assembled"
+        failures=$((failures + 1))
+        continue
+    fi
+    # the speed differs from run to run
+    "$simulator" $options "$work/$name.hex" > "$work/$name.out" 2>&1
+    sed 's/ in [0-9.e+-]* ms, .*//' "$work/$name.out" > "$work/$name.actual"
+    if ! diff "$dir/$name.expected" "$work/$name.actual"; then
+        echo "$name: unexpected result"
+        failures=$((failures + 1))
+    fi
+done
+
+[ $failures -eq 0 ]
@@ -0,0 +1,35 @@
+#!/bin/sh
+# usage: write_errors.sh mips-assembler files_dir
+# Outputs that can't be written (/dev/full) fail the run with a message
+# instead of leaving truncated files behind an exit code of 0.
+set -u
+assembler=$1
+files=$2
+[ -w /dev/full ] || exit 0
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+source="$files/program1.txt"
+
+expect_failure() {
+    if "$@" > /dev/null 2> "$work/stderr"; then
+        echo "succeeded: $*"
+        exit 1
+    fi
+    if ! grep -q "could not be written" "$work/stderr"; then
+        echo "missing diagnostic for: $*"
+        cat "$work/stderr"
+        exit 1
+    fi
+}
+
+expect_failure "$assembler" "$source" /dev/full "$work/out.hex"
+expect_failure "$assembler" "$source" "$work/out.lst" /dev/full
+expect_failure "$assembler" --no-listing "$source" /dev/full
+expect_failure "$assembler" --stream "$source" /dev/full
+expect_failure "$assembler" --trace=/dev/full "$source" "$work/out.lst" "$work/out.hex"
+expect_failure "$assembler" --incremental="$work/state" "$source" "$work/out.lst" /dev/full
+
+mkdir "$work/out"
+echo "$source" > "$work/list"
+ln -s /dev/full "$work/out/program1.txt.hex"
+expect_failure "$assembler" --batch "$work/list" "$work/out"
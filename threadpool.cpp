@@ -0,0 +1,61 @@
+#include "threadpool.hpp"
+
+#include "trace.hpp"
+
+ThreadPool::ThreadPool(size_t threads) {
+    threads = threadCount(threads);
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back([this]() { work(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    task_added_.notify_all();
+    for (auto &worker: workers_) worker.join();
+}
+
+// --------------------------------------------------------
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    task_added_.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    task_done_.wait(lock, [this]() { return tasks_.empty() && running_ == 0; });
+}
+
+size_t ThreadPool::threadCount(size_t requested) {
+    if (requested != 0) return requested;
+    const size_t cores = std::thread::hardware_concurrency();
+    return cores == 0 ? 1 : cores;
+}
+
+// --------------------------------------------------------
+
+void ThreadPool::work() {
+    traceThreadName("worker");
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        task_added_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+        if (tasks_.empty()) return;  // stopping and nothing left to do
+
+        std::function<void()> task = std::move(tasks_.front());
+        tasks_.pop_front();
+        ++running_;
+        lock.unlock();
+        task();
+        lock.lock();
+        --running_;
+        if (tasks_.empty() && running_ == 0) task_done_.notify_all();
+    }
+}
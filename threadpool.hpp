@@ -0,0 +1,52 @@
+#ifndef MIPS_THREADPOOL_H
+#define MIPS_THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed number of worker threads that run submitted tasks in the order
+ * they were submitted.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param threads number of worker threads, 0 starts one per core
+     */
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t size() const { return workers_.size(); }
+
+    void submit(std::function<void()> task);
+
+    /**
+     * @brief Blocks until every submitted task has finished.
+     */
+    void wait();
+
+    /**
+     * @brief Number of threads to use for the given request, 0 meaning one
+     * per core.
+     */
+    static size_t threadCount(size_t requested);
+
+private:
+    void work();
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable task_added_;
+    std::condition_variable task_done_;
+    size_t running_ = 0;
+    bool stopping_ = false;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "trace.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <unistd.h>
+
+#include "output.hpp"
+
+namespace {
+
+// a span ("X"), a counter value ("C") or a thread name ("M")
+struct TraceEvent {
+    char type;
+    const char *name;
+    const char *arg_name;
+    std::string arg;
+    int thread;
+    double begin;
+    double duration;
+    int64_t value;
+};
+
+std::atomic<bool> enabled{false};
+std::chrono::steady_clock::time_point start;
+std::mutex mutex;
+std::vector<TraceEvent> events;
+std::map<std::string, int64_t> totals;  // current value of every counter track
+std::atomic<int> next_thread{1};
+
+int threadId() {
+    thread_local const int id = next_thread++;
+    return id;
+}
+
+void record(TraceEvent event) {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back(std::move(event));
+}
+
+/**
+ * @brief Writes s as a JSON string.
+ */
+void writeJsonString(OutputBuffer &output, std::string_view s) {
+    output.put('"');
+    for (const char c: s) {
+        if (c == '"' || c == '\\') {
+            output.put('\\');
+            output.put(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            output.write(escaped);
+        } else {
+            output.put(c);
+        }
+    }
+    output.put('"');
+}
+
+void writeEvent(OutputBuffer &output, const TraceEvent &event, int pid) {
+    char fields[128];
+    output.write("{\"ph\":\"");
+    output.put(event.type);
+    output.write("\",\"name\":");
+    writeJsonString(output, event.name);
+    std::snprintf(fields, sizeof(fields), ",\"pid\":%d,\"tid\":%d", pid, event.thread);
+    output.write(fields);
+    if (event.type != 'M') {
+        std::snprintf(fields, sizeof(fields), ",\"ts\":%.3f", event.begin);
+        output.write(fields);
+    }
+    if (event.type == 'X') {
+        std::snprintf(fields, sizeof(fields), ",\"dur\":%.3f", event.duration);
+        output.write(fields);
+    }
+
+    output.write(",\"args\":{");
+    if (event.type == 'C') {
+        std::snprintf(fields, sizeof(fields), "\"value\":%lld", static_cast<long long>(event.value));
+        output.write(fields);
+    } else if (event.arg_name != nullptr) {
+        writeJsonString(output, event.arg_name);
+        output.put(':');
+        writeJsonString(output, event.arg);
+    }
+    output.write("}}");
+}
+
+}  // namespace
+
+// --------------------------------------------------------
+
+void startTrace() {
+    start = std::chrono::steady_clock::now();
+    enabled = true;
+    traceThreadName("main");
+}
+
+bool traceEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+bool writeTrace(const std::string &path) {
+    // writing the trace isn't part of it
+    enabled = false;
+    OutputBuffer output;
+    if (!output.open(path)) return false;
+
+    const int pid = static_cast<int>(getpid());
+    std::lock_guard<std::mutex> lock(mutex);
+    output.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (size_t i = 0; i < events.size(); ++i) {
+        writeEvent(output, events[i], pid);
+        output.write(i + 1 < events.size() ? ",\n" : "\n");
+    }
+    output.write("]}\n");
+    return output.close();
+}
+
+void traceThreadName(const char *name) {
+    if (!traceEnabled()) return;
+    record({'M', "thread_name", "name", name, threadId(), 0, 0, 0});
+}
+
+double traceNow() {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+void traceSpan(const char *name, double begin, const char *arg_name, const std::string &arg) {
+    if (!traceEnabled()) return;
+    record({'X', name, arg_name, arg, threadId(), begin, traceNow() - begin, 0});
+}
+
+void traceCount(const char *track, int64_t delta) {
+    if (!traceEnabled()) return;
+    const double now = traceNow();
+    std::lock_guard<std::mutex> lock(mutex);
+    const int64_t total = totals[track] += delta;
+    events.push_back({'C', track, nullptr, {}, threadId(), now, 0, total});
+}
+
+// --------------------------------------------------------
+
+TraceSpan::TraceSpan(const char *name, const char *arg_name, std::string arg)
+    : name_(name)
+    , arg_name_(arg_name)
+    , arg_(std::move(arg)) {
+    if (traceEnabled()) begin_ = traceNow();
+}
+
+TraceSpan::~TraceSpan() {
+    if (begin_ >= 0) traceSpan(name_, begin_, arg_name_, arg_);
+}
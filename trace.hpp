@@ -0,0 +1,70 @@
+#ifndef MIPS_TRACE_H
+#define MIPS_TRACE_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Starts recording trace events for --trace. Until then spans and
+ * counters do nothing, so they cost a load and a branch. The calling thread
+ * is named "main" in the trace.
+ */
+void startTrace();
+bool traceEnabled();
+
+/**
+ * @brief Writes the recorded events as Chrome trace event JSON, which
+ * chrome://tracing and Perfetto open.
+ *
+ * @param path the trace file, "-" writes to stdout
+ * @return bool false if the file couldn't be written
+ */
+bool writeTrace(const std::string &path);
+
+/**
+ * @brief Names the calling thread in the trace.
+ */
+void traceThreadName(const char *name);
+
+/**
+ * @brief Microseconds since startTrace, the time base of the trace.
+ */
+double traceNow();
+
+/**
+ * @brief Records a span of the calling thread that began at begin (from
+ * traceNow) and ends now.
+ *
+ * @param name static name of the span
+ * @param arg_name static name of an argument shown with the span, or nullptr
+ * @param arg value of that argument
+ */
+void traceSpan(const char *name, double begin, const char *arg_name = nullptr, const std::string &arg = {});
+
+/**
+ * @brief Adds delta to a counter track and records its new total. Safe to
+ * call from any thread.
+ *
+ * @param track static name of the counter track
+ */
+void traceCount(const char *track, int64_t delta);
+
+/**
+ * @brief Records its scope as a span of the calling thread.
+ */
+class TraceSpan {
+public:
+    explicit TraceSpan(const char *name) : TraceSpan(name, nullptr, {}) {}
+    TraceSpan(const char *name, const char *arg_name, std::string arg);
+    ~TraceSpan();
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+    const char *name_;
+    const char *arg_name_;
+    std::string arg_;
+    double begin_ = -1;  // negative while not tracing
+};
+
+#endif